@@ -0,0 +1,110 @@
+"""
+Benchmark del enlace CAN contra el nodo (placa real o build de host).
+
+1. Ping -> latido: mantiene --window pings en vuelo durante --seconds y
+   mide tramas/s y el tiempo de ida y vuelta (eco del latido, 0x710/0x701).
+2. Eventos: hace de RPi (ConfirmStandIn) mientras el nodo genera accesos y
+   mide eventos/s, retransmisiones y trama de eventos -> ACK/confirmación.
+
+Uso:
+    python3 can_bench.py [--channel vcan0] [--seconds 5] [--window 4] [--drop 0]
+"""
+
+import argparse
+import statistics
+import struct
+import time
+
+import can
+
+from can_standin import ConfirmStandIn, CAN_ID_FP_EVENT
+
+CAN_ID_HEARTBEAT = 0x701
+CAN_ID_HB_PING = 0x710
+
+
+def percentile(values, p):
+    if not values:
+        return float("nan")
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * p / 100))]
+
+
+def bench_ping(bus, seconds, window):
+    in_flight = {}
+    rtts = []
+    sent = received = 0
+    tag = 0
+    end = time.monotonic() + seconds
+
+    while time.monotonic() < end:
+        while len(in_flight) < window:
+            tag = (tag + 1) & 0xFFFF
+            in_flight[tag] = time.monotonic()
+            bus.send(can.Message(arbitration_id=CAN_ID_HB_PING,
+                                 data=struct.pack("<I", tag),
+                                 is_extended_id=False))
+            sent += 1
+
+        msg = bus.recv(timeout=0.5)
+        if msg is None:
+            in_flight.clear()       # ping perdido: reiniciar la ventana
+            continue
+        if msg.arbitration_id != CAN_ID_HEARTBEAT or len(msg.data) < 8:
+            continue
+
+        # Latido: eco en bytes 4-5, espera en el nodo en bytes 6-7
+        echo = msg.data[4] | (msg.data[5] << 8)
+        t0 = in_flight.pop(echo, None)
+        if t0 is not None:
+            rtts.append((time.monotonic() - t0) * 1000.0)
+            received += 1
+
+    total = sent + received
+    print(f"ping: {sent} enviados, {received} respondidos, "
+          f"{total / seconds:.0f} tramas/s")
+    if rtts:
+        print(f"  RTT ms: min {min(rtts):.2f}  p50 {percentile(rtts, 50):.2f}  "
+              f"p99 {percentile(rtts, 99):.2f}  max {max(rtts):.2f}")
+
+
+def bench_events(bus, seconds, drop):
+    standin = ConfirmStandIn(bus, drop=drop)
+    latencies = []
+    end = time.monotonic() + seconds
+
+    while time.monotonic() < end:
+        msg = bus.recv(timeout=0.1)
+        if msg is None:
+            continue
+        if msg.arbitration_id == CAN_ID_FP_EVENT:
+            t0 = time.monotonic()
+            standin.on_message(msg)
+            latencies.append((time.monotonic() - t0) * 1000.0)
+
+    s = standin.stats
+    print(f"eventos: {s['events']} ({s['events'] / seconds:.1f}/s) en "
+          f"{s['frames']} tramas, MATCH {s['matches']}, "
+          f"duplicados {s['duplicates']}, perdidas simuladas {s['dropped']}")
+    if latencies:
+        print(f"  trama -> ACK/confirmación ms: media {statistics.mean(latencies):.3f}  "
+              f"max {max(latencies):.3f}")
+
+
+# =====================
+# MAIN
+# =====================
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--channel", default="vcan0")
+    parser.add_argument("--seconds", type=float, default=5.0)
+    parser.add_argument("--window", type=int, default=4)
+    parser.add_argument("--drop", type=float, default=0.0)
+    args = parser.parse_args()
+
+    bus = can.interface.Bus(channel=args.channel, interface="socketcan")
+    try:
+        bench_ping(bus, args.seconds, args.window)
+        bench_events(bus, args.seconds, args.drop)
+    finally:
+        bus.shutdown()
@@ -0,0 +1,199 @@
+"""
+Envío de firmware al STM32 por CAN (ver stm32/.../Core/Inc/fw_update.h).
+
+1. BEGIN con tamaño y CRC-32 de la imagen; el nodo borra la zona de staging
+   (varios segundos, sin CAN) y contesta READY.
+2. Bloques de hasta 504 bytes por ISO-TP en 0x6B0: [offset, CRC-32, datos].
+   Se mantienen --window bloques sin BLOCK_OK para que el nodo programe uno
+   mientras llega el siguiente.
+3. COMMIT (CRC de toda la imagen en flash) y, con --activate, ACTIVATE.
+
+Uso:
+    python3 can_fw_update.py firmware.bin [--channel can0] [--window 2] [--activate]
+"""
+
+import argparse
+import struct
+import sys
+import time
+import zlib
+
+import can
+
+CAN_ID_TP_FW = 0x6B0
+CAN_ID_TP_FW_FC = 0x6B8
+CAN_ID_FW_CONTROL = 0x6C0
+CAN_ID_FW_STATUS = 0x6C8
+
+FW_CMD_BEGIN = 0x01
+FW_CMD_COMMIT = 0x02
+FW_CMD_ABORT = 0x03
+FW_CMD_ACTIVATE = 0x04
+FW_EVT_READY = 0x10
+FW_EVT_BLOCK_OK = 0x11
+FW_EVT_BLOCK_ERR = 0x12
+
+FW_BLOCK_DATA = 504
+ERASE_TIMEOUT_S = 15.0
+STATUS_TIMEOUT_S = 2.0
+
+
+class FwError(Exception):
+    pass
+
+
+class FwSender:
+    def __init__(self, bus, window=2):
+        self.bus = bus
+        self.window = window
+        self.status = []            # (cmd, estado, valor) pendientes de leer
+
+    def _send(self, arb_id, data):
+        self.bus.send(can.Message(arbitration_id=arb_id, data=data,
+                                  is_extended_id=False))
+
+    def _poll(self, timeout):
+        """Lee una trama; guarda las de estado y devuelve las de FC."""
+        msg = self.bus.recv(timeout=timeout)
+        if msg is None or msg.is_extended_id:
+            return None
+        if msg.arbitration_id == CAN_ID_FW_STATUS and len(msg.data) >= 6:
+            cmd, st, value = struct.unpack("<BBI", bytes(msg.data[:6]))
+            self.status.append((cmd, st, value))
+        elif msg.arbitration_id == CAN_ID_TP_FW_FC:
+            return msg
+        return None
+
+    def _wait_status(self, cmds, timeout):
+        end = time.monotonic() + timeout
+        while True:
+            for i, s in enumerate(self.status):
+                if s[0] in cmds:
+                    return self.status.pop(i)
+            left = end - time.monotonic()
+            if left <= 0:
+                raise FwError(f"sin respuesta a {cmds}")
+            self._poll(left)
+
+    def _isotp_send(self, payload):
+        """FF + CF con espera del primer FC (el nodo anuncia BS = 0)."""
+        n = len(payload)
+        self._send(CAN_ID_TP_FW, bytes([0x10 | (n >> 8), n & 0xFF]) + payload[:6])
+
+        end = time.monotonic() + 1.0
+        while True:
+            fc = self._poll(max(0.0, end - time.monotonic()))
+            if fc is not None and fc.data[0] & 0xF0 == 0x30:
+                fs = fc.data[0] & 0x0F
+                if fs == 0x00:
+                    break
+                if fs == 0x02:
+                    raise FwError("FC overflow: el nodo no tiene bloque libre")
+                end = time.monotonic() + 1.0        # WAIT
+            elif time.monotonic() >= end:
+                raise FwError("sin flow control")
+
+        bs, stmin = fc.data[1], fc.data[2]
+        sn, pos, count = 1, 6, 0
+        while pos < n:
+            self._send(CAN_ID_TP_FW, bytes([0x20 | sn]) + payload[pos:pos + 7])
+            pos += 7
+            sn = (sn + 1) & 0x0F
+            count += 1
+            if stmin and stmin <= 0x7F:
+                time.sleep(stmin / 1000.0)
+            if bs and count == bs and pos < n:
+                count = 0
+                while True:
+                    fc = self._poll(1.0)
+                    if fc is None:
+                        raise FwError("sin flow control")
+                    if fc.data[0] == 0x30:
+                        break
+
+    def update(self, image, activate=False):
+        crc = zlib.crc32(image) & 0xFFFFFFFF
+        size = len(image)
+
+        t0 = time.monotonic()
+        self._send(CAN_ID_FW_CONTROL,
+                   bytes([FW_CMD_BEGIN]) + struct.pack("<I", size)[:3] + struct.pack("<I", crc))
+        _, st, _ = self._wait_status({FW_EVT_READY, FW_CMD_BEGIN}, ERASE_TIMEOUT_S)
+        if st != 0:
+            raise FwError(f"BEGIN rechazado ({st}; 1 = puerta abierta o en movimiento)")
+        t_erase = time.monotonic() - t0
+
+        pending = {}                # offset -> payload sin BLOCK_OK
+        offsets = list(range(0, size, FW_BLOCK_DATA))
+        retries = 0
+        done = 0
+
+        while offsets or pending:
+            while offsets and len(pending) < self.window:
+                off = offsets.pop(0)
+                data = image[off:off + FW_BLOCK_DATA]
+                payload = struct.pack("<II", off, zlib.crc32(data) & 0xFFFFFFFF) + data
+                self._isotp_send(payload)
+                pending[off] = payload
+
+            cmd, st, off = self._wait_status({FW_EVT_BLOCK_OK, FW_EVT_BLOCK_ERR},
+                                             STATUS_TIMEOUT_S)
+            if off not in pending:
+                continue
+            if cmd == FW_EVT_BLOCK_OK:
+                done += len(pending.pop(off)) - 8
+            else:
+                # Reintento: el nodo ignora palabras que ya tienen el valor
+                retries += 1
+                if retries > 16:
+                    raise FwError(f"bloque {off:#x} rechazado ({st})")
+                del pending[off]
+                offsets.insert(0, off)
+
+            sys.stdout.write(f"\r{done:>7}/{size}")
+            sys.stdout.flush()
+
+        self._send(CAN_ID_FW_CONTROL, [FW_CMD_COMMIT])
+        _, st, value = self._wait_status({FW_CMD_COMMIT}, ERASE_TIMEOUT_S)
+        if st != 0:
+            raise FwError(f"COMMIT rechazado ({st}, CRC {value:#010x})")
+
+        elapsed = time.monotonic() - t0
+        print(f"\n{size} bytes en {elapsed:.1f} s (borrado {t_erase:.1f} s), "
+              f"{size / (elapsed - t_erase):.0f} B/s, reintentos {retries}")
+
+        if activate:
+            self._send(CAN_ID_FW_CONTROL, [FW_CMD_ACTIVATE])
+            _, st, _ = self._wait_status({FW_CMD_ACTIVATE}, STATUS_TIMEOUT_S)
+            if st != 0:
+                raise FwError(f"ACTIVATE rechazado ({st})")
+            print("activando: el nodo reinicia y el cargador copia la imagen")
+
+    def abort(self):
+        self._send(CAN_ID_FW_CONTROL, [FW_CMD_ABORT])
+
+
+# =====================
+# MAIN
+# =====================
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("image")
+    parser.add_argument("--channel", default="can0")
+    parser.add_argument("--window", type=int, default=2)
+    parser.add_argument("--activate", action="store_true")
+    args = parser.parse_args()
+
+    with open(args.image, "rb") as f:
+        image = f.read()
+
+    bus = can.interface.Bus(channel=args.channel, interface="socketcan")
+    sender = FwSender(bus, args.window)
+    try:
+        sender.update(image, args.activate)
+    except FwError as e:
+        print(f"\nerror: {e}")
+        sender.abort()
+        sys.exit(1)
+    finally:
+        bus.shutdown()
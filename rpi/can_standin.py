@@ -0,0 +1,118 @@
+"""
+Stand-in de la RPi para pruebas sin placa: lógica de confirmación de accesos.
+
+- Eventos de huella (0x123): [seq, n, n x evento 16 bits BE]
+  (bit 15 = match, bits 0-14 = ID). Se contesta con ACK acumulativo en 0x128
+  y, por cada MATCH nuevo, con la confirmación de apertura en 0x124.
+- Los duplicados (retransmisiones) solo se vuelven a confirmar con ACK.
+
+Uso:
+    python3 can_standin.py [--channel vcan0] [--drop 0.05] [--delay-ms 0]
+"""
+
+import argparse
+import random
+import threading
+import time
+
+import can
+
+CAN_ID_FP_EVENT = 0x123
+CAN_ID_FP_CONFIRM = 0x124
+CAN_ID_FP_EVENT_ACK = 0x128
+
+EVT_WINDOW = 4          # CAN_EVT_WINDOW del STM32
+FLAG_START = 0x80       # primera trama desde el arranque del STM32
+
+
+class ConfirmStandIn:
+    def __init__(self, bus, drop=0.0, delay_ms=0, verbose=False):
+        self.bus = bus
+        self.drop = drop
+        self.delay_s = delay_ms / 1000.0
+        self.verbose = verbose
+        self.expected = None        # siguiente seq en orden
+        self.stats = {"frames": 0, "events": 0, "matches": 0,
+                      "duplicates": 0, "dropped": 0}
+
+    def _send(self, arb_id, data):
+        self.bus.send(can.Message(arbitration_id=arb_id, data=data,
+                                  is_extended_id=False))
+
+    def on_event_frame(self, msg):
+        if len(msg.data) < 2:
+            return
+
+        # Pérdida simulada: la trama no llega a la RPi
+        if self.drop and random.random() < self.drop:
+            self.stats["dropped"] += 1
+            return
+
+        seq, n = msg.data[0], msg.data[1] & 0x7F
+        self.stats["frames"] += 1
+
+        # Secuencia nueva: STM32 reiniciado o seq fuera de toda ventana
+        dist = (seq - self.expected) & 0xFF if self.expected is not None else 0
+        if (self.expected is None or msg.data[1] & FLAG_START or
+                EVT_WINDOW <= dist <= 0xFF - EVT_WINDOW):
+            self.expected = seq
+
+        if seq != self.expected:
+            # Duplicado o hueco: repetir el último ACK en orden
+            self.stats["duplicates"] += 1
+            self._send(CAN_ID_FP_EVENT_ACK, [(self.expected - 1) & 0xFF])
+            return
+
+        self.expected = (seq + 1) & 0xFF
+
+        if self.delay_s:
+            time.sleep(self.delay_s)
+
+        self._send(CAN_ID_FP_EVENT_ACK, [seq])
+
+        for i in range(n):
+            evt = (msg.data[2 + 2 * i] << 8) | msg.data[3 + 2 * i]
+            self.stats["events"] += 1
+            if evt & 0x8000:
+                self.stats["matches"] += 1
+                if self.verbose:
+                    print(f" Dedaso : ID {evt & 0x7FFF} (seq {seq})")
+                self._send(CAN_ID_FP_CONFIRM, [1])
+            elif self.verbose:
+                print(f" No match (seq {seq})")
+
+    def on_message(self, msg):
+        if msg.arbitration_id == CAN_ID_FP_EVENT and not msg.is_extended_id:
+            self.on_event_frame(msg)
+
+
+def run(bus, standin, stop):
+    while not stop.is_set():
+        msg = bus.recv(timeout=0.1)
+        if msg is not None:
+            standin.on_message(msg)
+
+
+# =====================
+# MAIN
+# =====================
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--channel", default="vcan0")
+    parser.add_argument("--drop", type=float, default=0.0,
+                        help="probabilidad de perder una trama de eventos")
+    parser.add_argument("--delay-ms", type=int, default=0,
+                        help="retardo antes de confirmar")
+    args = parser.parse_args()
+
+    bus = can.interface.Bus(channel=args.channel, interface="socketcan")
+    standin = ConfirmStandIn(bus, args.drop, args.delay_ms, verbose=True)
+    stop = threading.Event()
+
+    try:
+        run(bus, standin, stop)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        print(standin.stats)
+        bus.shutdown()
@@ -0,0 +1,50 @@
+/*
+ * can_bitrate.h
+ *
+ *  Negociación del bitrate del bus con la RPi.
+ *
+ *  Petición (RPi -> STM32, CAN_ID_BITRATE_REQUEST):
+ *    [cmd, kbit/s (16 bits LE), punto de muestreo ‰ (16 bits LE, 0 = 875)]
+ *  Respuesta (STM32 -> RPi, CAN_ID_BITRATE_RESPONSE):
+ *    [cmd, estado, kbit/s (16 bits LE), punto de muestreo real ‰ (16 bits LE)]
+ *
+ *  1. PROPOSE: el nodo valida la temporización y responde al bitrate actual.
+ *     Si es válida, CAN_BITRATE_SWITCH_MS después cambia los dos
+ *     controladores (la RPi cambia al recibir la respuesta).
+ *  2. CONFIRM, enviado por la RPi ya al bitrate nuevo, lo deja fijo.
+ *  3. Si el CONFIRM no llega en CAN_BITRATE_CONFIRM_MS, el nodo vuelve al
+ *     bitrate anterior y lo avisa con una respuesta FALLBACK.
+ *  Si un controlador no acepta el bitrate nuevo, los dos vuelven al anterior
+ *  y se responde FALLBACK con CAN_BITRATE_ERR_APPLY. Los cambios los hace la
+ *  tarea CANBR, despertada por el temporizador.
+ */
+
+#ifndef INC_CAN_BITRATE_H_
+#define INC_CAN_BITRATE_H_
+
+#include <stdint.h>
+#include "can_bsp.h"
+
+#define CAN_BITRATE_CMD_PROPOSE     0x01
+#define CAN_BITRATE_CMD_CONFIRM     0x02
+#define CAN_BITRATE_CMD_QUERY       0x03
+#define CAN_BITRATE_CMD_FALLBACK    0x04    // solo en respuestas
+
+#define CAN_BITRATE_OK              0x00
+#define CAN_BITRATE_ERR_INVALID     0x01    // bitrate no representable
+#define CAN_BITRATE_ERR_BUSY        0x02    // negociación en curso
+#define CAN_BITRATE_ERR_NOT_PENDING 0x03    // CONFIRM sin PROPOSE
+#define CAN_BITRATE_ERR_APPLY       0x04    // un controlador no aceptó la temporización
+
+#define CAN_BITRATE_SWITCH_MS       100
+#define CAN_BITRATE_CONFIRM_MS      1000
+
+void CAN_Bitrate_Init(void);
+
+/* Bitrate actual de CAN1 en kbit/s */
+uint32_t CAN_Bitrate_GetKbps(void);
+
+/* Handler de la tabla de despacho para CAN_ID_BITRATE_REQUEST */
+void CAN_Bitrate_OnRequest(const can_bsp_msg_t *msg, void *ctx);
+
+#endif /* INC_CAN_BITRATE_H_ */
@@ -21,16 +21,198 @@ typedef struct {
     uint32_t id;
     uint8_t  dlc;
     uint8_t  data[8];
+    uint16_t hw_timestamp;  // contador de bit del bxCAN (solo con CAN_BSP_USE_TTCM)
+    uint32_t timestamp;     // CAN_BSP_Now() al sacar la trama del FIFO (RX)
 } can_bsp_msg_t;
 
+/*
+ * Marca de tiempo de alta resolución: contador de ciclos DWT (168 MHz,
+ * da la vuelta cada ~25 s; las diferencias siguen siendo válidas).
+ * Con CAN_BSP_USE_TTCM = 1 el bxCAN además captura en hw_timestamp el
+ * contador de tiempo de bit en el SOF de cada trama.
+ */
+#define CAN_BSP_USE_TTCM        0
+
+uint32_t CAN_BSP_Now(void);
+uint32_t CAN_BSP_CyclesToUs(uint32_t cycles);
+
+/*
+ * Cola de transmisión software: una banda por cada 0x200 IDs (ID más bajo,
+ * más prioridad, igual que en el arbitraje del bus). Dentro de una banda el
+ * orden es FIFO. Los mailboxes se rellenan desde la interrupción de TX.
+ */
+#define CAN_BSP_TX_BANDS        4
+#define CAN_BSP_TX_BAND_LEN     8       // potencia de 2
+#define CAN_BSP_TX_BAND_SHIFT   9       // 11 bits de ID / 4 bandas
+
+typedef struct {
+    uint32_t queued;        // tramas aceptadas por CAN_BSP_Send
+    uint32_t sent;          // transmisiones completadas
+    uint32_t overflows;     // descartadas por banda llena
+    uint32_t aborted;       // abortadas en el mailbox
+    uint8_t  high_water;    // ocupación máxima de una banda
+    uint32_t mb_latency_us[3];      // última latencia mailbox -> fin de TX
+    uint32_t mb_latency_max_us[3];  // máxima desde CAN_BSP_ResetTxLatency
+} can_bsp_tx_stats_t;
+
+/* Estado de error de un controlador (registro ESR) */
+#define CAN_BSP_BUS1            0
+#define CAN_BSP_BUS2            1
+
+typedef struct {
+    uint8_t tec;            // transmit error counter
+    uint8_t rec;            // receive error counter
+    uint8_t lec;            // last error code (0 = ninguno)
+    uint8_t warning;        // TEC o REC >= 96
+    uint8_t passive;        // TEC o REC > 127
+    uint8_t bus_off;        // TEC > 255
+} can_bsp_bus_status_t;
+
+/*
+ * Filtros de aceptación. Cada módulo registra los IDs (o rangos) que consume
+ * antes de CAN_BSP_Init, y el BSP reparte los bancos del bxCAN:
+ *   - IDs sueltos: modo lista de 16 bits, 4 IDs por banco
+ *   - rangos: se parten en bloques alineados, modo máscara de 16 bits,
+ *     2 por banco
+ * CAN1 usa los bancos 0-13 y CAN2 los 14-27, con la misma tabla.
+ * Sin filtros registrados (o si no caben) se acepta todo, como antes.
+ */
+#define CAN_BSP_MAX_FILTERS     32
+#define CAN_BSP_SLAVE_BANK      14      // primer banco de CAN2
+#define CAN_BSP_NUM_BANKS       28
+
+#define CAN_BSP_FIFO0           0
+#define CAN_BSP_FIFO1           1
+
 void CAN_BSP_Init(void);
 
+can_bsp_status_t CAN_BSP_AddFilter(uint32_t std_id, uint8_t fifo);
+can_bsp_status_t CAN_BSP_AddFilterRange(uint32_t first_id, uint32_t last_id, uint8_t fifo);
+
 
+/*
+ * Encola una trama sin bloquear. CAN_BSP_BUSY indica que la banda de ese ID
+ * está llena y la trama se ha descartado.
+ */
 can_bsp_status_t CAN_BSP_Send(uint32_t std_id,
                               const uint8_t *data,
                               uint8_t len);
 
-/* Callback débil (hook) */
-void CAN_BSP_RxCallback(const can_bsp_msg_t *msg);
+/* CAN1; CAN_BSP_GetBusTxStats para cada controlador */
+can_bsp_tx_stats_t CAN_BSP_GetTxStats(void);
+can_bsp_tx_stats_t CAN_BSP_GetBusTxStats(uint8_t bus);
+void CAN_BSP_ResetTxLatency(void);
+
+/*
+ * Redundancia CAN1/CAN2. CAN_BSP_Send usa el bus activo (CAN1 al
+ * arrancar); can_health cambia de bus cuando el activo queda en error
+ * pasivo o bus-off y el otro está sano (arnés cortado o en corto).
+ *   NONE:     solo CAN1, sin conmutación
+ *   FAILOVER: bus activo con conmutación automática
+ *   DUAL:     además, CAN_BSP_SendCritical duplica la trama en los dos
+ *             buses y en recepción se descarta la copia del otro bus
+ * Por defecto NONE: la placa actual solo lleva el TJA1042 de CAN1 (ver
+ * docs/hardware.md). Con un segundo transceptor en CAN2 se activa con
+ * OD 0x1009 (OD_SYS_CAN_REDUNDANCY).
+ */
+#define CAN_BSP_REDUNDANCY_NONE     0
+#define CAN_BSP_REDUNDANCY_FAILOVER 1
+#define CAN_BSP_REDUNDANCY_DUAL     2
+
+#define CAN_BSP_DEDUP_LEN       8
+#define CAN_BSP_DEDUP_MS        50
+
+void CAN_BSP_SetRedundancy(uint8_t mode);
+uint8_t CAN_BSP_GetRedundancy(void);
+
+/* Cambia el bus de transmisión; la cola pendiente pasa al nuevo bus */
+can_bsp_status_t CAN_BSP_SetActiveBus(uint8_t bus);
+uint8_t CAN_BSP_GetActiveBus(void);
+
+/* Encola en un bus concreto, sea o no el activo (sondeo del bus caído) */
+can_bsp_status_t CAN_BSP_SendOnBus(uint8_t bus, uint32_t std_id,
+                                   const uint8_t *data, uint8_t len);
+
+/* Ni tramas en cola ni mailboxes cargados */
+uint8_t CAN_BSP_TxIdle(uint8_t bus);
+
+/* Tramas críticas (accesos, confirmaciones): por los dos buses en DUAL */
+can_bsp_status_t CAN_BSP_SendCritical(uint32_t std_id,
+                                      const uint8_t *data,
+                                      uint8_t len);
+
+void CAN_BSP_GetBusStatus(uint8_t bus, can_bsp_bus_status_t *status);
+
+/*
+ * Reinicia el controlador (salida forzada de bus-off). Si HAL_CAN_Start
+ * agota su timeout (bus bloqueado) reinicializa el handle y reintenta
+ * hasta CAN_BSP_RESTART_RETRIES veces; con error el controlador queda
+ * parado y listo para el siguiente intento.
+ */
+#define CAN_BSP_RESTART_RETRIES 2
+
+can_bsp_status_t CAN_BSP_Restart(uint8_t bus);
+
+/*
+ * Temporización de bit. El reloj del bxCAN es PCLK1 (42 MHz):
+ *   bitrate = PCLK1 / (prescaler * (1 + bs1 + bs2))
+ *   punto de muestreo = (1 + bs1) / (1 + bs1 + bs2)
+ * Solo se aceptan bitrates exactos y un punto de muestreo a menos de
+ * CAN_BSP_SP_TOLERANCE del pedido.
+ */
+#define CAN_BSP_MAX_BITRATE     1000000
+#define CAN_BSP_DEFAULT_SP      875     // tanto por mil (CiA 301)
+#define CAN_BSP_SP_TOLERANCE    50      // tanto por mil
+#define CAN_BSP_TQ_MIN          8
+#define CAN_BSP_TQ_MAX          25
+
+typedef struct {
+    uint32_t bitrate;
+    uint16_t prescaler;     // 1..1024
+    uint8_t  bs1;           // 1..16 TQ
+    uint8_t  bs2;           // 1..8 TQ
+    uint8_t  sjw;           // 1..4 TQ
+    uint16_t sample_point;  // tanto por mil
+} can_bsp_timing_t;
+
+/* sample_point = 0 usa CAN_BSP_DEFAULT_SP */
+can_bsp_status_t CAN_BSP_CalcTiming(uint32_t bitrate, uint16_t sample_point, can_bsp_timing_t *timing);
+
+/*
+ * Reprograma el controlador con una temporización ya calculada: pasa por
+ * modo init (los mailboxes pendientes salen después) y conserva filtros e
+ * interrupciones.
+ */
+can_bsp_status_t CAN_BSP_SetTiming(uint8_t bus, const can_bsp_timing_t *timing);
+can_bsp_status_t CAN_BSP_SetBitrate(uint8_t bus, uint32_t bitrate, uint16_t sample_point);
+void CAN_BSP_GetTiming(uint8_t bus, can_bsp_timing_t *timing);
+
+/*
+ * Recepción: cada interrupción vacía el FIFO entero y entrega las tramas en
+ * un lote (máximo la profundidad del FIFO). FIFO0 lleva el tráfico normal;
+ * FIFO1, los IDs urgentes (paro de emergencia, órdenes de puerta).
+ */
+#define CAN_BSP_RX_BATCH        3
+
+typedef struct {
+    uint32_t fifo0_frames;
+    uint32_t fifo1_frames;
+    uint32_t fifo0_overruns;    // tramas perdidas por FIFO lleno (FOVR)
+    uint32_t fifo1_overruns;
+    uint8_t  max_batch;         // tramas recogidas en una sola interrupción
+    uint32_t duplicates;        // copias redundantes descartadas (DUAL)
+    uint32_t bus_frames[2];     // recibidas por CAN1 / CAN2
+} can_bsp_rx_stats_t;
+
+can_bsp_rx_stats_t CAN_BSP_GetRxStats(void);
+
+/* Callbacks débiles (hooks), llamados desde la ISR */
+void CAN_BSP_RxCallback(const can_bsp_msg_t *msgs, uint8_t count);
+
+/* Por defecto reenvía a CAN_BSP_RxCallback */
+void CAN_BSP_RxUrgentCallback(const can_bsp_msg_t *msgs, uint8_t count);
+
+/* Aviso, error pasivo o bus-off (bits HAL_CAN_ERROR_*), desde la ISR SCE */
+void CAN_BSP_ErrorCallback(uint8_t bus, uint32_t error);
 
 #endif
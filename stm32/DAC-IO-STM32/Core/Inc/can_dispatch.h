@@ -0,0 +1,38 @@
+/*
+ * can_dispatch.h
+ *
+ *  Despacho de tramas CAN recibidas por tabla: ID -> (handler, contexto).
+ *  La tabla es const, ordenada por ID en el código fuente, y se busca con
+ *  búsqueda binaria, así que el coste no depende de cuántos IDs haya.
+ *  Los handlers reciben un puntero a la trama (sin copia) y se ejecutan en
+ *  la tarea que llama a CAN_Dispatch.
+ */
+
+#ifndef INC_CAN_DISPATCH_H_
+#define INC_CAN_DISPATCH_H_
+
+#include <stdint.h>
+#include "can_bsp.h"
+
+typedef void (*can_handler_t)(const can_bsp_msg_t *msg, void *ctx);
+
+typedef struct {
+    uint16_t      id;
+    uint8_t       fifo;     // CAN_BSP_FIFO0 / CAN_BSP_FIFO1 (filtro hardware)
+    can_handler_t handler;
+    void         *ctx;
+} can_dispatch_entry_t;
+
+/*
+ * Comprueba que la tabla está ordenada sin IDs repetidos y registra un
+ * filtro de aceptación por entrada. Llamar antes de CAN_BSP_Init.
+ */
+void CAN_Dispatch_Init(const can_dispatch_entry_t *table, uint16_t count);
+
+/* Llama al handler del ID. Devuelve 1 si había entrada en la tabla */
+uint8_t CAN_Dispatch(const can_bsp_msg_t *msg);
+
+/* Tramas recibidas sin entrada en la tabla */
+uint32_t CAN_Dispatch_GetUnhandled(void);
+
+#endif /* INC_CAN_DISPATCH_H_ */
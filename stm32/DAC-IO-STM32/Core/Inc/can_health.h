@@ -0,0 +1,62 @@
+/*
+ * can_health.h
+ *
+ *  Salud del bus CAN: contadores de error (TEC/REC), último código de error,
+ *  transiciones a error pasivo / bus-off con su instante, recuperaciones y
+ *  latencia de TX por mailbox. Se publica periódicamente en
+ *  CAN_ID_CAN_HEALTH (una trama por controlador) y en cada cambio de estado:
+ *    [bus | estado << 4, TEC, REC, LEC, nº bus-off, nº recuperaciones,
+ *     latencia TX máx. en µs (16 bits LE)]
+ *
+ *  También decide el bus activo (ver CAN_BSP_SetRedundancy): conmuta al
+ *  otro bus si el activo pasa a error pasivo o bus-off. Para volver a CAN1
+ *  no basta con el TEC: sin transmitir por CAN1 no baja nunca. Mientras
+ *  CAN2 es el activo se sondea CAN1 con su trama de salud cada
+ *  CAN_HEALTH_PROBE_MS; se vuelve cuando CAN1 lleva CAN_HEALTH_FAILBACK_MS
+ *  dando señales de vida (sondeos con ACK o tramas recibidas) y ha salido
+ *  de error pasivo (los sondeos con ACK bajan el TEC).
+ */
+
+#ifndef INC_CAN_HEALTH_H_
+#define INC_CAN_HEALTH_H_
+
+#include <stdint.h>
+#include "can_bsp.h"
+
+#define CAN_HEALTH_POLL_MS          100
+#define CAN_HEALTH_PUBLISH_MS       1000
+#define CAN_HEALTH_RESTART_MS       1000    // bus-off sin recuperar -> reinicio manual
+#define CAN_HEALTH_FAILBACK_MS      5000    // CAN1 con señales de vida -> vuelve a ser el activo
+#define CAN_HEALTH_PROBE_MS         200     // sondeo de CAN1 mientras transmite CAN2
+
+typedef enum {
+    CAN_HEALTH_ACTIVE = 0,
+    CAN_HEALTH_WARNING,
+    CAN_HEALTH_PASSIVE,
+    CAN_HEALTH_BUS_OFF
+} can_health_state_t;
+
+typedef struct {
+    can_health_state_t state;
+    uint8_t  tec;
+    uint8_t  rec;
+    uint8_t  lec;               // último código de error distinto de 0
+    uint32_t warning_count;
+    uint32_t passive_count;
+    uint32_t busoff_count;
+    uint32_t recoveries;        // salidas de bus-off (automáticas o forzadas)
+    uint32_t restarts;          // reinicios forzados del controlador
+    uint32_t restart_errors;    // reinicios en los que el controlador no volvió al bus
+    uint32_t failovers;         // veces que se dejó de transmitir por este bus
+    uint32_t last_change_ms;
+    uint32_t last_passive_ms;
+    uint32_t last_busoff_ms;
+    uint32_t last_recovery_ms;
+} can_health_t;
+
+/* Crea el temporizador de sondeo y publicación */
+void CAN_Health_Init(void);
+
+can_health_t CAN_Health_Get(uint8_t bus);
+
+#endif /* INC_CAN_HEALTH_H_ */
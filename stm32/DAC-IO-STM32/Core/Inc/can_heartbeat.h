@@ -0,0 +1,35 @@
+/*
+ * can_heartbeat.h
+ *
+ *  Latido periódico del nodo y medida de latencia de ida y vuelta.
+ *
+ *  Ping (RPi -> STM32, CAN_ID_HB_PING):  [marca de tiempo RPi (32 bits LE)]
+ *  Latido (STM32 -> RPi, CAN_ID_HEARTBEAT):
+ *    [seq, estado puerta, uptime s (16 bits LE), eco de la marca (16 bits LE),
+ *     ms desde que llegó el ping (16 bits LE)]
+ *
+ *  Cada ping se contesta con un latido inmediato. La RPi calcula
+ *  RTT = ahora - eco - espera (módulo 2^16) y da el nodo por caído si pasa
+ *  un periodo sin latido.
+ */
+
+#ifndef INC_CAN_HEARTBEAT_H_
+#define INC_CAN_HEARTBEAT_H_
+
+#include <stdint.h>
+#include "can_bsp.h"
+
+#define CAN_HEARTBEAT_DEFAULT_MS    1000
+#define CAN_HEARTBEAT_MIN_MS        100
+#define CAN_HEARTBEAT_MAX_MS        10000
+
+void CAN_Heartbeat_Init(void);
+
+/* 0 desactiva el latido periódico (los pings se siguen contestando) */
+uint8_t CAN_Heartbeat_SetPeriod(uint32_t period_ms);
+uint32_t CAN_Heartbeat_GetPeriod(void);
+
+/* Handler de la tabla de despacho para CAN_ID_HB_PING */
+void CAN_Heartbeat_OnPing(const can_bsp_msg_t *msg, void *ctx);
+
+#endif /* INC_CAN_HEARTBEAT_H_ */
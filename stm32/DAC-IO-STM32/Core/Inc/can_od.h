@@ -0,0 +1,80 @@
+/*
+ * can_od.h
+ *
+ *  Diccionario de objetos para configurar y vigilar la puerta desde la RPi,
+ *  al estilo de SDO/PDO de CANopen pero reducido.
+ *
+ *  Petición (RPi -> STM32, CAN_ID_OD_REQUEST):
+ *    [cmd, índice lo, índice hi, arg, valor (32 bits LE)]
+ *  Respuesta (STM32 -> RPi, CAN_ID_OD_RESPONSE):
+ *    [cmd, índice lo, índice hi, estado, valor (32 bits LE)]
+ *  PDO (STM32 -> RPi, CAN_ID_OD_PDO_BASE + ranura):
+ *    [índice lo, índice hi, valor (32 bits LE)]
+ *
+ *  SUBSCRIBE: valor = periodo en ms (0 = solo por cambio), arg bit 0 = enviar
+ *  también cuando cambie. La respuesta lleva la ranura en el byte de valor.
+ */
+
+#ifndef INC_CAN_OD_H_
+#define INC_CAN_OD_H_
+
+#include <stdint.h>
+#include "can_bsp.h"
+
+/* Comandos */
+#define CAN_OD_CMD_READ         0x01
+#define CAN_OD_CMD_WRITE        0x02
+#define CAN_OD_CMD_SUBSCRIBE    0x03
+#define CAN_OD_CMD_UNSUBSCRIBE  0x04
+
+/* arg de SUBSCRIBE */
+#define CAN_OD_SUB_ON_CHANGE    0x01
+
+/* Estados de la respuesta */
+#define CAN_OD_OK               0x00
+#define CAN_OD_ERR_NO_OBJECT    0x01
+#define CAN_OD_ERR_READ_ONLY    0x02
+#define CAN_OD_ERR_RANGE        0x03
+#define CAN_OD_ERR_FAILED       0x04    // el módulo no aceptó el valor
+#define CAN_OD_ERR_NO_SLOT      0x05
+#define CAN_OD_ERR_BAD_CMD      0x06
+
+/* Índices: 0x1xxx sistema, 0x2xxx puerta/motor, 0x21xx huella, 0x22xx pantalla */
+#define OD_SYS_UPTIME_S         0x1001
+#define OD_SYS_FREE_HEAP        0x1002
+#define OD_SYS_CAN_TX_OVERFLOWS 0x1003
+#define OD_SYS_CAN_RX_DROPS     0x1004
+#define OD_SYS_CAN_TEC          0x1005
+#define OD_SYS_CAN_BUSOFFS      0x1006
+#define OD_SYS_HEARTBEAT_MS     0x1007
+#define OD_SYS_CAN_BITRATE_KBPS 0x1008
+#define OD_SYS_CAN_REDUNDANCY   0x1009
+#define OD_SYS_CAN_ACTIVE_BUS   0x100A
+#define OD_SYS_CAN_RX_LAT_MAX_US 0x100B
+#define OD_DOOR_STATE           0x2000
+#define OD_DOOR_OPEN_TIME_MS    0x2001
+#define OD_MOTOR_STEP_MS        0x2002
+#define OD_DOOR_OPERATIONS      0x2003
+#define OD_FP_QUIET_MS          0x2100
+#define OD_FP_UPLOAD_ON_REJECT  0x2101
+#define OD_FP_SCANS             0x2102
+#define OD_FP_MATCHES           0x2103
+#define OD_FP_REJECTIONS        0x2104
+#define OD_FP_CONFIRM_LOOP_MS   0x2105
+#define OD_FP_EVENTS_DROPPED    0x2106
+#define OD_FP_UART_OVERFLOWS    0x2107
+#define OD_DISPLAY_CONTRAST     0x2200
+#define OD_DISPLAY_UPDATE_BYTES 0x2201  // bytes SPI de la última actualización
+#define OD_DISPLAY_RENDER_MAX_US 0x2202 // dibujo de un fotograma de la puerta
+
+/* Suscripciones PDO */
+#define CAN_OD_MAX_SUBS         4
+#define CAN_OD_PDO_TICK_MS      50      // resolución del temporizador de PDO
+
+/* Crea el temporizador de PDO. Llamar antes de arrancar el scheduler */
+void CAN_OD_Init(void);
+
+/* Handler de la tabla de despacho para CAN_ID_OD_REQUEST */
+void CAN_OD_OnRequest(const can_bsp_msg_t *msg, void *ctx);
+
+#endif /* INC_CAN_OD_H_ */
@@ -14,8 +14,84 @@
 #include "queue.h"
 #include "can_bsp.h"
 
+/* Identificadores CAN de la aplicación */
+#define CAN_ID_EMERGENCY_STOP 0x080 // RPi -> STM32: paro de emergencia (FIFO1)
+#define CAN_ID_DOOR_COMMAND 0x090   // RPi -> STM32: cerrar puerta (FIFO1)
+#define CAN_ID_FP_EVENT     0x123   // STM32 -> RPi: resultado de autenticación
+#define CAN_ID_FP_CONFIRM   0x124   // RPi -> STM32: abrir puerta
+#define CAN_ID_FP_ENROLL    0x125   // STM32 -> RPi: progreso del enrolamiento
+#define CAN_ID_FP_COMMAND   0x126   // RPi -> STM32: enrolamiento / subir imagen
+#define CAN_ID_FP_IMAGE_INFO 0x127  // STM32 -> RPi: resultado de la subida de imagen
+#define CAN_ID_FP_EVENT_ACK 0x128   // RPi -> STM32: ACK acumulativo de CAN_ID_FP_EVENT
+#define CAN_ID_OD_PDO_BASE  0x181   // STM32 -> RPi: PDO de suscripción (+ ranura)
+#define CAN_ID_REMOTE_COMMAND 0x200 // RPi -> STM32: comando remoto de depuración
+#define CAN_ID_OD_RESPONSE  0x581   // STM32 -> RPi: respuesta del diccionario de objetos
+#define CAN_ID_OD_REQUEST   0x601   // RPi -> STM32: lectura / escritura / suscripción
+#define CAN_ID_TP_IMAGE     0x6A0   // STM32 -> RPi: imagen del sensor (ISO-TP)
+#define CAN_ID_TP_IMAGE_FC  0x6A8   // RPi -> STM32: flow control de la imagen
+#define CAN_ID_TP_FW        0x6B0   // RPi -> STM32: bloques de firmware (ISO-TP, fw_update.h)
+#define CAN_ID_TP_FW_FC     0x6B8   // STM32 -> RPi: flow control de los bloques
+#define CAN_ID_FW_CONTROL   0x6C0   // RPi -> STM32: BEGIN / COMMIT / ABORT / ACTIVATE
+#define CAN_ID_FW_STATUS    0x6C8   // STM32 -> RPi: estado de la actualización
+#define CAN_ID_HEARTBEAT    0x701   // STM32 -> RPi: latido (can_heartbeat.h)
+#define CAN_ID_CAN_HEALTH   0x702   // STM32 -> RPi: diagnóstico del bus (can_health.h)
+#define CAN_ID_HB_PING      0x710   // RPi -> STM32: ping con marca de tiempo
+#define CAN_ID_BITRATE_REQUEST  0x7E0   // RPi -> STM32: negociación de bitrate (can_bitrate.h)
+#define CAN_ID_BITRATE_RESPONSE 0x7E8   // STM32 -> RPi: respuesta de la negociación
+
+/* Comandos en data[0] de CAN_ID_FP_COMMAND */
+#define CAN_FP_CMD_ENROLL_CANCEL  0x00
+#define CAN_FP_CMD_ENROLL_START   0x01
+#define CAN_FP_CMD_UPLOAD_IMAGE   0x02
+
+/* data[0] de CAN_ID_DOOR_COMMAND (no hay apertura remota sin huella) */
+#define CAN_DOOR_CMD_CLOSE        0x00
+
+/* Entrega de eventos de acceso con secuencia y ACK */
+#define CAN_EVT_WINDOW            4       // tramas sin confirmar
+#define CAN_EVT_PER_FRAME         3       // eventos por trama (2 + 3 * 2 bytes)
+#define CAN_EVT_FLAG_START        0x80    // en data[1]: primera trama desde el arranque
+#define CAN_EVT_RETX_MS           200
+
+#define CAN_RX_QUEUE_LEN          8
+#define CAN_URGENT_QUEUE_LEN      4
+
+typedef struct {
+    uint32_t rx_queue_drops;      // tramas perdidas por cola de RX llena
+    uint32_t urgent_queue_drops;
+    uint32_t confirm_loop_ms;     // último evento 0x123 -> confirmación 0x124 (llegada al FIFO)
+    uint32_t confirm_local_us;    // de esa espera, la parte en cola y despacho del nodo
+    uint32_t confirm_loop_max_ms;
+    uint32_t evt_frames;          // tramas de eventos nuevas
+    uint32_t evt_retransmits;
+} can_app_stats_t;
+
+/*
+ * Latencia de recepción por etapas, medida con la marca de tiempo que pone
+ * la ISR (can_bsp_msg_t.timestamp) en cada trama:
+ *   FIFO -> cola (ISR), FIFO -> tarea (incluye la espera en cola) y la
+ *   duración del handler. Una entrada para FIFO0 y otra para FIFO1.
+ */
+#define CAN_RX_PATH_NORMAL        0
+#define CAN_RX_PATH_URGENT        1
+
+typedef struct {
+    uint32_t frames;
+    uint32_t to_queue_us;
+    uint32_t to_queue_max_us;
+    uint32_t to_task_us;
+    uint32_t to_task_max_us;
+    uint32_t handler_us;
+    uint32_t handler_max_us;
+} can_rx_latency_t;
+
 void CANTask_Init(void);
 QueueHandle_t CAN_App_GetRxQueue(void);
-static QueueHandle_t can_rx_queue;
+can_app_stats_t CAN_App_GetStats(void);
+can_rx_latency_t CAN_App_GetRxLatency(uint8_t path);
+void CAN_App_ResetRxLatency(void);
+
+/* Hook débil para CAN_ID_REMOTE_COMMAND (se llama desde la tarea CANRX) */
+void CAN_App_OnRemoteCommand(const can_bsp_msg_t *msg);
 
 #endif /* INC_CAN_TASK_H_ */
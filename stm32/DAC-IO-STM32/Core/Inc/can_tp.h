@@ -0,0 +1,140 @@
+/*
+ * can_tp.h
+ *
+ *  Transporte segmentado estilo ISO 15765-2 (ISO-TP) sobre CAN_BSP_Send.
+ *  Permite mover bloques mayores de 8 bytes (imágenes, plantillas, logs,
+ *  configuración, firmware) como SF / FF + CF con control de flujo (FC).
+ *
+ *  Cada canal une un ID de recepción con su ID de transmisión. Las sesiones
+ *  se identifican por ese ID, así que varios canales pueden estar
+ *  transfiriendo a la vez. Los buffers de reensamblado salen de un pool
+ *  fijo y se entregan al callback sin copiarlos.
+ *
+ *  Rendimiento ESTIMADO a 500 kbit/s, calculado y sin medir en placa
+ *  (trama de 8 bytes ~130 bits con bit stuffing medio, ~3800 tramas/s,
+ *  7 bytes útiles por CF):
+ *    BS = 0, STmin = 0   ->  ~26 KB/s
+ *    BS = 8, STmin = 0   ->  ~18 KB/s (un FC de ida y vuelta cada 56 bytes)
+ *    STmin = 1 ms        ->  ~7 KB/s
+ *  Los valores reales se miden en cada transferencia (CAN_TP_GetStats).
+ */
+
+#ifndef INC_CAN_TP_H_
+#define INC_CAN_TP_H_
+
+#include <stdint.h>
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "can_bsp.h"
+
+/* PCI (nibble alto del primer byte) */
+#define CAN_TP_PCI_SF   0x00    // Single Frame
+#define CAN_TP_PCI_FF   0x10    // First Frame
+#define CAN_TP_PCI_CF   0x20    // Consecutive Frame
+#define CAN_TP_PCI_FC   0x30    // Flow Control
+
+/* Flow status del FC */
+#define CAN_TP_FS_CTS     0x00
+#define CAN_TP_FS_WAIT    0x01
+#define CAN_TP_FS_OVFLW   0x02
+
+/* Longitud máxima con FF de 12 bits; por encima se usa el escape de 32 bits */
+#define CAN_TP_FF_DL_12BIT_MAX  4095
+
+/* Canales y pool de reensamblado */
+#define CAN_TP_MAX_CHANNELS     4
+#define CAN_TP_POOL_BLOCKS      4
+#define CAN_TP_BLOCK_SIZE       512
+
+/* Parámetros por defecto que anunciamos como receptor */
+#define CAN_TP_DEFAULT_BS       8
+#define CAN_TP_DEFAULT_STMIN    0
+
+/* Timeouts (N_As, N_Bs, N_Cr) y número máximo de FC WAIT seguidos */
+#define CAN_TP_TX_TIMEOUT_MS    100
+#define CAN_TP_FC_TIMEOUT_MS    1000
+#define CAN_TP_CF_TIMEOUT_MS    1000
+#define CAN_TP_WFT_MAX          8
+
+typedef enum {
+    CAN_TP_OK = 0,
+    CAN_TP_ERROR,
+    CAN_TP_TIMEOUT,
+    CAN_TP_OVERFLOW
+} can_tp_status_t;
+
+/*
+ * Mensaje recibido completo. data apunta al bloque del pool (o a la trama
+ * en un SF). Devolver 1 para quedarse el bloque y liberarlo más tarde con
+ * CAN_TP_Release(); devolver 0 lo libera al volver del callback.
+ * En un SF data apunta a una copia temporal y el valor devuelto se ignora.
+ */
+typedef uint8_t (*can_tp_rx_cb_t)(uint32_t rx_id, uint8_t *data, uint32_t len, void *ctx);
+
+typedef struct can_tp_channel can_tp_channel_t;
+
+/* Sesión de envío en streaming: solo guarda la trama en construcción */
+typedef struct {
+    can_tp_channel_t *chan;
+    uint32_t   tx_id;
+    uint32_t   total;       // longitud anunciada en el FF
+    uint32_t   queued;      // bytes ya aceptados por CAN_TP_StreamWrite
+    uint8_t    sn;          // sequence number del siguiente CF
+    uint8_t    frame[8];
+    uint8_t    fill;        // bytes ocupados en frame
+    uint8_t    bs;          // block size pedido por el receptor
+    uint8_t    block_cnt;   // CF enviados en el bloque actual
+    TickType_t stmin;       // separación mínima entre CF
+    uint8_t    need_fc;     // esperar FC antes del siguiente CF
+    uint32_t   frames;
+    TickType_t start;
+} can_tp_tx_t;
+
+typedef struct {
+    uint32_t tx_transfers;
+    uint32_t tx_bytes;
+    uint32_t tx_frames;
+    uint32_t tx_errors;
+    uint32_t tx_last_bytes_per_s;
+    uint32_t rx_transfers;
+    uint32_t rx_bytes;
+    uint32_t rx_last_bytes_per_s;
+    uint32_t rx_overflows;      // sin bloque libre o mensaje demasiado largo
+    uint32_t rx_timeouts;
+    uint32_t rx_sn_errors;
+} can_tp_stats_t;
+
+/*
+ * Une rx_id (tramas que recibimos: datos y FC) con tx_id (tramas que
+ * enviamos: datos y nuestros FC). on_rx puede ser NULL si el canal solo
+ * transmite. Llamar desde los Init de las tareas, antes del scheduler.
+ * rx_id necesita además una entrada en la tabla de despacho de can_task.c
+ * que llame a CAN_TP_OnFrame.
+ */
+can_tp_status_t CAN_TP_Bind(uint32_t rx_id, uint32_t tx_id,
+                            can_tp_rx_cb_t on_rx, void *ctx);
+
+/* BS y STmin que anunciamos al emisor remoto en este canal */
+can_tp_status_t CAN_TP_SetRxParams(uint32_t rx_id, uint8_t bs, uint8_t stmin);
+
+/* Procesa una trama recibida. Devuelve 1 si pertenece a un canal ISO-TP */
+uint8_t CAN_TP_OnFrame(const can_bsp_msg_t *msg);
+
+/* Libera un bloque que el callback se quedó */
+void CAN_TP_Release(uint8_t *block);
+
+/* Abre una transferencia de total_len bytes hacia tx_id */
+can_tp_status_t CAN_TP_StreamBegin(can_tp_tx_t *tx, uint32_t tx_id, uint32_t total_len);
+
+/* Añade datos; se envían tramas a medida que se completan */
+can_tp_status_t CAN_TP_StreamWrite(can_tp_tx_t *tx, const uint8_t *data, uint32_t len);
+
+/* Envía la última trama parcial y comprueba que se envió todo lo anunciado */
+can_tp_status_t CAN_TP_StreamEnd(can_tp_tx_t *tx);
+
+/* Envío de un bloque completo ya en memoria */
+can_tp_status_t CAN_TP_Send(uint32_t tx_id, const uint8_t *data, uint32_t len);
+
+can_tp_stats_t CAN_TP_GetStats(void);
+
+#endif /* INC_CAN_TP_H_ */
@@ -13,4 +13,3 @@
 #include "task.h"
 #include "fingerprint_task.h"
 #include "can_task.h"
-void ConsumerTask_Init(void);
@@ -10,10 +10,21 @@
 
 #include "main.h"
 #include <stdint.h>
+#include <stdbool.h>
 
 /* Display dimensions */
 #define SSD1309_WIDTH   128
 #define SSD1309_HEIGHT  64
+#define SSD1309_PAGES   (SSD1309_HEIGHT / 8)
+
+/* Contrast after init (command 0x81) */
+#define SSD1309_DEFAULT_CONTRAST    0xCF
+
+/* Longest wait for a DMA transfer (1024 bytes take ~1.6 ms at 5.25 MHz) */
+#define SSD1309_DMA_TIMEOUT_MS      50
+
+/* Segments in one batch: a window plus its data for each page */
+#define SSD1309_MAX_SEGMENTS        (2 * SSD1309_PAGES)
 
 /* Pin definitions - AJUSTAR SEGÚN TU HARDWARE */
 #define SSD1309_CS_PORT     GPIOB
@@ -46,6 +57,13 @@ void BSP_SSD1309_Reset(void);
  */
 void BSP_SSD1309_SendCommand(uint8_t cmd);
 
+/**
+ * @brief Send a command sequence with a single CS assertion
+ * @param cmds: Command bytes (with their arguments)
+ * @param len: Number of bytes
+ */
+void BSP_SSD1309_SendCommands(const uint8_t *cmds, uint16_t len);
+
 /**
  * @brief Send data to SSD1309
  * @param data: Pointer to data buffer
@@ -53,12 +71,81 @@ void BSP_SSD1309_SendCommand(uint8_t cmd);
  */
 void BSP_SSD1309_SendData(uint8_t* data, uint16_t size);
 
+/**
+ * @brief Start a DMA data transfer and return immediately
+ * @param data: Buffer to send, must stay unchanged until the transfer ends
+ * @param size: Number of bytes to send
+ * @note  CS is released from the DMA completion callback
+ */
+void BSP_SSD1309_SendDataAsync(uint8_t* data, uint16_t size);
+
+/**
+ * @brief Block the calling task until the current DMA transfer ends
+ * @retval false on DMA error or timeout (the transfer is aborted)
+ */
+bool BSP_SSD1309_WaitTransfer(void);
+
 /**
  * @brief Update screen with buffer content
  * @param buffer: Pointer to display buffer
+ * @note  The calling task sleeps while DMA sends the buffer
  */
 void BSP_SSD1309_UpdateScreen(uint8_t* buffer);
 
+/**
+ * @brief Set the column/page window for the next data bytes (0x21/0x22)
+ * @param x0, x1: First and last column (0-127)
+ * @param page0, page1: First and last page (0-7)
+ */
+void BSP_SSD1309_SetWindow(uint8_t x0, uint8_t x1, uint8_t page0, uint8_t page1);
+
+/**
+ * @brief Send a rectangle of the buffer (columns x0-x1 of pages page0-page1)
+ * @param buffer: Pointer to display buffer (full 128x64 layout)
+ * @param x0, x1: First and last column
+ * @param page0, page1: First and last page
+ */
+void BSP_SSD1309_UpdateRegion(uint8_t* buffer, uint8_t x0, uint8_t x1, uint8_t page0, uint8_t page1);
+
+/**
+ * @brief Start a new batch (waits for the previous transfer to end)
+ * @note  A batch is a chain of window and data segments that the DMA
+ *        completion interrupt sends back to back under one CS assertion
+ * @retval false if the previous transfer failed or timed out
+ */
+bool BSP_SSD1309_BatchBegin(void);
+
+/**
+ * @brief Append a 0x21/0x22 window to the batch
+ * @retval false if the batch is full
+ */
+bool BSP_SSD1309_BatchWindow(uint8_t x0, uint8_t x1, uint8_t page0, uint8_t page1);
+
+/**
+ * @brief Append data bytes to the batch
+ * @param data: Must stay unchanged until the transfer ends
+ * @retval false if the batch is full
+ */
+bool BSP_SSD1309_BatchData(uint8_t* data, uint16_t size);
+
+/**
+ * @brief Append a window and the buffer rectangle it covers
+ * @retval false if the batch is full
+ */
+bool BSP_SSD1309_BatchRegion(uint8_t* buffer, uint8_t x0, uint8_t x1, uint8_t page0, uint8_t page1);
+
+/**
+ * @brief Send the batch in the background; use BSP_SSD1309_WaitTransfer to join
+ * @retval false if the transfer could not be started
+ */
+bool BSP_SSD1309_BatchStart(void);
+
+/**
+ * @brief Set display contrast
+ * @param contrast: 0x00 (dim) to 0xFF (bright)
+ */
+void BSP_SSD1309_SetContrast(uint8_t contrast);
+
 /**
  * @brief Clear display buffer
  * @param buffer: Pointer to display buffer
@@ -14,6 +14,14 @@
 /* Display dimensions */
 #define DISPLAY_WIDTH   128
 #define DISPLAY_HEIGHT  64
+#define DISPLAY_PAGES   (DISPLAY_HEIGHT / 8)
+
+/* SPI bytes spent on one 0x21/0x22 window (used to decide page merging) */
+#define DISPLAY_WINDOW_COST         6
+
+/* Display_Swap frame period; a gap of this many periods restarts the pacing */
+#define DISPLAY_FRAME_MS            30
+#define DISPLAY_PACING_RESYNC       4
 
 /* Color definitions */
 typedef enum {
@@ -21,13 +29,24 @@ typedef enum {
     COLOR_WHITE = 1
 } color_t;
 
-/* Font sizes */
+/* Font sizes (see display_font.c) */
 typedef enum {
-    FONT_6X8 = 0,
-    FONT_8X16,
-    FONT_12X16
+    FONT_6X8 = 0,           // fixed 6-pixel cell
+    FONT_6X8_PROP,          // same glyphs, proportional widths
+    FONT_12X16,             // 6x8 glyphs doubled
+    FONT_DIGITS_14X24,      // 0-9 : . - for clocks and countdowns
+    FONT_COUNT
 } font_size_t;
 
+/* Transfer statistics for Display_Update */
+typedef struct {
+    uint32_t updates;       // calls that sent something
+    uint32_t bytes;         // SPI bytes sent, window commands included
+    uint16_t last_bytes;    // bytes of the last update (full screen: 1030)
+    uint32_t frames;        // Display_Swap calls
+    uint32_t late_frames;   // frames rendered slower than the frame period
+} display_update_stats_t;
+
 /* Function prototypes */
 
 /**
@@ -42,10 +61,38 @@ bool Display_Init(void);
 void Display_Clear(void);
 
 /**
- * @brief Update display from internal buffer
+ * @brief Send the parts of the buffer changed since the last update
+ * @note  Returns once the transfer has finished
  */
 void Display_Update(void);
 
+/**
+ * @brief Double-buffered update for animations
+ *
+ * Waits for the next frame slot (DISPLAY_FRAME_MS by default) and for the
+ * previous transfer, then starts sending this frame by DMA and returns so
+ * the next frame can be drawn while it goes out. Drawing always targets
+ * the back buffer, which starts as a copy of the frame just presented.
+ */
+void Display_Swap(void);
+
+/**
+ * @brief Set the frame period used by Display_Swap
+ * @param ms: Frame period in milliseconds
+ */
+void Display_SetFramePeriod(uint16_t ms);
+
+/**
+ * @brief Mark the whole screen dirty so the next update resends it
+ */
+void Display_Invalidate(void);
+
+/**
+ * @brief Get Display_Update transfer statistics
+ * @retval Copy of the statistics
+ */
+display_update_stats_t Display_GetUpdateStats(void);
+
 /**
  * @brief Draw a pixel
  * @param x: X coordinate (0-127)
@@ -62,6 +109,22 @@ void Display_DrawPixel(uint8_t x, uint8_t y, color_t color);
  */
 void Display_DrawLine(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, color_t color);
 
+/**
+ * @brief Draw a horizontal line
+ * @param x, y: Left end
+ * @param w: Length in pixels
+ * @param color: Line color
+ */
+void Display_DrawHLine(uint8_t x, uint8_t y, uint8_t w, color_t color);
+
+/**
+ * @brief Draw a vertical line
+ * @param x, y: Top end
+ * @param h: Length in pixels
+ * @param color: Line color
+ */
+void Display_DrawVLine(uint8_t x, uint8_t y, uint8_t h, color_t color);
+
 /**
  * @brief Draw a rectangle
  * @param x, y: Top-left corner
@@ -104,9 +167,25 @@ void Display_DrawChar(uint8_t x, uint8_t y, char c, font_size_t font, color_t co
  */
 void Display_DrawString(uint8_t x, uint8_t y, const char *str, font_size_t font, color_t color);
 
+/**
+ * @brief Width of a string as Display_DrawString would draw it
+ * @param str: String to measure
+ * @param font: Font size
+ * @retval Width in pixels, trailing glyph spacing excluded
+ */
+uint16_t Display_GetTextWidth(const char *str, font_size_t font);
+
+/**
+ * @brief Set panel contrast
+ * @param contrast: 0x00 (dim) to 0xFF (bright)
+ */
+void Display_SetContrast(uint8_t contrast);
+
 /**
  * @brief Get pointer to display buffer (for direct manipulation)
  * @retval Pointer to buffer
+ * @note  Marks the whole screen dirty, as the caller may write anywhere.
+ *        The back buffer changes on every update: do not keep the pointer
  */
 uint8_t* Display_GetBuffer(void);
 
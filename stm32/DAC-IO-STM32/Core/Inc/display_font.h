@@ -1,125 +1,63 @@
 /**
  ******************************************************************************
  * @file           : display_font.h
- * @brief          : Complete 6x8 font for display driver
+ * @brief          : Font engine for the display driver
  ******************************************************************************
  */
 
 #ifndef DISPLAY_FONT_H
 #define DISPLAY_FONT_H
 
+#include "display_driver.h"
 #include <stdint.h>
 
-/* Complete 6x8 font - ASCII 32 to 126 (95 characters) */
-static const uint8_t font_6x8[95][6] = {
-    /* ASCII 32 - 47 (Space, symbols) */
-    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // Space (32)
-    {0x00, 0x00, 0x5F, 0x00, 0x00, 0x00}, // !
-    {0x00, 0x07, 0x00, 0x07, 0x00, 0x00}, // "
-    {0x14, 0x7F, 0x14, 0x7F, 0x14, 0x00}, // #
-    {0x24, 0x2A, 0x7F, 0x2A, 0x12, 0x00}, // $
-    {0x23, 0x13, 0x08, 0x64, 0x62, 0x00}, // %
-    {0x36, 0x49, 0x55, 0x22, 0x50, 0x00}, // &
-    {0x00, 0x05, 0x03, 0x00, 0x00, 0x00}, // '
-    {0x00, 0x1C, 0x22, 0x41, 0x00, 0x00}, // (
-    {0x00, 0x41, 0x22, 0x1C, 0x00, 0x00}, // )
-    {0x14, 0x08, 0x3E, 0x08, 0x14, 0x00}, // *
-    {0x08, 0x08, 0x3E, 0x08, 0x08, 0x00}, // +
-    {0x00, 0x50, 0x30, 0x00, 0x00, 0x00}, // ,
-    {0x08, 0x08, 0x08, 0x08, 0x08, 0x00}, // -
-    {0x00, 0x60, 0x60, 0x00, 0x00, 0x00}, // .
-    {0x20, 0x10, 0x08, 0x04, 0x02, 0x00}, // /
-    
-    /* ASCII 48 - 57 (Numbers 0-9) */
-    {0x3E, 0x51, 0x49, 0x45, 0x3E, 0x00}, // 0
-    {0x00, 0x42, 0x7F, 0x40, 0x00, 0x00}, // 1
-    {0x42, 0x61, 0x51, 0x49, 0x46, 0x00}, // 2
-    {0x21, 0x41, 0x45, 0x4B, 0x31, 0x00}, // 3
-    {0x18, 0x14, 0x12, 0x7F, 0x10, 0x00}, // 4
-    {0x27, 0x45, 0x45, 0x45, 0x39, 0x00}, // 5
-    {0x3C, 0x4A, 0x49, 0x49, 0x30, 0x00}, // 6
-    {0x01, 0x71, 0x09, 0x05, 0x03, 0x00}, // 7
-    {0x36, 0x49, 0x49, 0x49, 0x36, 0x00}, // 8
-    {0x06, 0x49, 0x49, 0x29, 0x1E, 0x00}, // 9
-    
-    /* ASCII 58 - 64 (: ; < = > ? @) */
-    {0x00, 0x36, 0x36, 0x00, 0x00, 0x00}, // :
-    {0x00, 0x56, 0x36, 0x00, 0x00, 0x00}, // ;
-    {0x08, 0x14, 0x22, 0x41, 0x00, 0x00}, // <
-    {0x14, 0x14, 0x14, 0x14, 0x14, 0x00}, // =
-    {0x00, 0x41, 0x22, 0x14, 0x08, 0x00}, // >
-    {0x02, 0x01, 0x51, 0x09, 0x06, 0x00}, // ?
-    {0x32, 0x49, 0x79, 0x41, 0x3E, 0x00}, // @
-    
-    /* ASCII 65 - 90 (A-Z) */
-    {0x7E, 0x11, 0x11, 0x11, 0x7E, 0x00}, // A
-    {0x7F, 0x49, 0x49, 0x49, 0x36, 0x00}, // B
-    {0x3E, 0x41, 0x41, 0x41, 0x22, 0x00}, // C
-    {0x7F, 0x41, 0x41, 0x22, 0x1C, 0x00}, // D
-    {0x7F, 0x49, 0x49, 0x49, 0x41, 0x00}, // E
-    {0x7F, 0x09, 0x09, 0x09, 0x01, 0x00}, // F
-    {0x3E, 0x41, 0x49, 0x49, 0x7A, 0x00}, // G
-    {0x7F, 0x08, 0x08, 0x08, 0x7F, 0x00}, // H
-    {0x00, 0x41, 0x7F, 0x41, 0x00, 0x00}, // I
-    {0x20, 0x40, 0x41, 0x3F, 0x01, 0x00}, // J
-    {0x7F, 0x08, 0x14, 0x22, 0x41, 0x00}, // K
-    {0x7F, 0x40, 0x40, 0x40, 0x40, 0x00}, // L
-    {0x7F, 0x02, 0x0C, 0x02, 0x7F, 0x00}, // M
-    {0x7F, 0x04, 0x08, 0x10, 0x7F, 0x00}, // N
-    {0x3E, 0x41, 0x41, 0x41, 0x3E, 0x00}, // O
-    {0x7F, 0x09, 0x09, 0x09, 0x06, 0x00}, // P
-    {0x3E, 0x41, 0x51, 0x21, 0x5E, 0x00}, // Q
-    {0x7F, 0x09, 0x19, 0x29, 0x46, 0x00}, // R
-    {0x46, 0x49, 0x49, 0x49, 0x31, 0x00}, // S
-    {0x01, 0x01, 0x7F, 0x01, 0x01, 0x00}, // T
-    {0x3F, 0x40, 0x40, 0x40, 0x3F, 0x00}, // U
-    {0x1F, 0x20, 0x40, 0x20, 0x1F, 0x00}, // V
-    {0x3F, 0x40, 0x38, 0x40, 0x3F, 0x00}, // W
-    {0x63, 0x14, 0x08, 0x14, 0x63, 0x00}, // X
-    {0x07, 0x08, 0x70, 0x08, 0x07, 0x00}, // Y
-    {0x61, 0x51, 0x49, 0x45, 0x43, 0x00}, // Z
-    
-    /* ASCII 91 - 96 ([ \ ] ^ _ `) */
-    {0x00, 0x7F, 0x41, 0x41, 0x00, 0x00}, // [
-    {0x02, 0x04, 0x08, 0x10, 0x20, 0x00}, // backslash
-    {0x00, 0x41, 0x41, 0x7F, 0x00, 0x00}, // ]
-    {0x04, 0x02, 0x01, 0x02, 0x04, 0x00}, // ^
-    {0x40, 0x40, 0x40, 0x40, 0x40, 0x00}, // _
-    {0x00, 0x01, 0x02, 0x04, 0x00, 0x00}, // `
-    
-    /* ASCII 97 - 122 (a-z) */
-    {0x20, 0x54, 0x54, 0x54, 0x78, 0x00}, // a
-    {0x7F, 0x48, 0x44, 0x44, 0x38, 0x00}, // b
-    {0x38, 0x44, 0x44, 0x44, 0x20, 0x00}, // c
-    {0x38, 0x44, 0x44, 0x48, 0x7F, 0x00}, // d
-    {0x38, 0x54, 0x54, 0x54, 0x18, 0x00}, // e
-    {0x08, 0x7E, 0x09, 0x01, 0x02, 0x00}, // f
-    {0x0C, 0x52, 0x52, 0x52, 0x3E, 0x00}, // g
-    {0x7F, 0x08, 0x04, 0x04, 0x78, 0x00}, // h
-    {0x00, 0x44, 0x7D, 0x40, 0x00, 0x00}, // i
-    {0x20, 0x40, 0x44, 0x3D, 0x00, 0x00}, // j
-    {0x7F, 0x10, 0x28, 0x44, 0x00, 0x00}, // k
-    {0x00, 0x41, 0x7F, 0x40, 0x00, 0x00}, // l
-    {0x7C, 0x04, 0x18, 0x04, 0x78, 0x00}, // m
-    {0x7C, 0x08, 0x04, 0x04, 0x78, 0x00}, // n
-    {0x38, 0x44, 0x44, 0x44, 0x38, 0x00}, // o
-    {0x7C, 0x14, 0x14, 0x14, 0x08, 0x00}, // p
-    {0x08, 0x14, 0x14, 0x18, 0x7C, 0x00}, // q
-    {0x7C, 0x08, 0x04, 0x04, 0x08, 0x00}, // r
-    {0x48, 0x54, 0x54, 0x54, 0x20, 0x00}, // s
-    {0x04, 0x3F, 0x44, 0x40, 0x20, 0x00}, // t
-    {0x3C, 0x40, 0x40, 0x20, 0x7C, 0x00}, // u
-    {0x1C, 0x20, 0x40, 0x20, 0x1C, 0x00}, // v
-    {0x3C, 0x40, 0x30, 0x40, 0x3C, 0x00}, // w
-    {0x44, 0x28, 0x10, 0x28, 0x44, 0x00}, // x
-    {0x0C, 0x50, 0x50, 0x50, 0x3C, 0x00}, // y
-    {0x44, 0x64, 0x54, 0x4C, 0x44, 0x00}, // z
-    
-    /* ASCII 123 - 126 ({ | } ~) */
-    {0x00, 0x08, 0x36, 0x41, 0x00, 0x00}, // {
-    {0x00, 0x00, 0x7F, 0x00, 0x00, 0x00}, // |
-    {0x00, 0x41, 0x36, 0x08, 0x00, 0x00}, // }
-    {0x10, 0x08, 0x08, 0x10, 0x08, 0x00}, // ~
-};
+/* 6x8 glyphs: ASCII 32 to 126 */
+#define FONT_6X8_FIRST          32
+#define FONT_6X8_GLYPHS         95
+
+/* Largest decoded glyph (FONT_DIGITS_14X24: 14 columns x 3 pages) */
+#define FONT_GLYPH_MAX_BYTES    48
+
+/* Glyph ready to blit: `pages` rows of `width` column bytes, LSB on top */
+typedef struct {
+    const uint8_t *columns;     // NULL: blank glyph, nothing to draw
+    uint8_t width;              // columns drawn
+    uint8_t advance;            // cursor step to the next glyph
+    uint8_t pages;              // glyph height / 8
+} display_glyph_t;
+
+/* Shared 6x8 table: FONT_6X8, FONT_6X8_PROP and FONT_12X16 all read it */
+extern const uint8_t font_6x8[FONT_6X8_GLYPHS][6];
+
+/**
+ * @brief Get a glyph in page format
+ * @param font: Font size
+ * @param c: Character; unsupported characters draw as a blank
+ * @param scratch: FONT_GLYPH_MAX_BYTES buffer for glyphs that must be decoded
+ * @param glyph: Filled in; columns may point into flash or into scratch
+ */
+void Font_GetGlyph(font_size_t font, char c, uint8_t *scratch, display_glyph_t *glyph);
+
+/**
+ * @brief Get the width and advance of a glyph without decoding it
+ * @param font: Font size
+ * @param c: Character
+ * @param width: Columns the glyph draws
+ * @param advance: Cursor step to the next glyph
+ */
+void Font_GetMetrics(font_size_t font, char c, uint8_t *width, uint8_t *advance);
+
+/**
+ * @brief Get the height of a font in pages
+ */
+uint8_t Font_GetPages(font_size_t font);
+
+/**
+ * @brief Get the table of a one-page fixed-cell font to index it directly
+ * @param first, last: Characters that have glyphs
+ * @param width: Cell width; glyph c starts at table[(c - first) * width]
+ * @retval Glyph table, or NULL if the font is not a one-page fixed font
+ */
+const uint8_t *Font_GetFixedTable(font_size_t font, char *first, char *last, uint8_t *width);
 
 #endif /* DISPLAY_FONT_H */
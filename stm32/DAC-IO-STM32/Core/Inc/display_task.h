@@ -20,14 +20,27 @@ typedef enum {
     DISPLAY_EVENT_DOOR_OPEN,
     DISPLAY_EVENT_DOOR_CLOSED,
     DISPLAY_EVENT_ERROR,
-    DISPLAY_EVENT_IDLE
+    DISPLAY_EVENT_IDLE,
+    DISPLAY_EVENT_ENROLL_PLACE,
+    DISPLAY_EVENT_ENROLL_LIFT,
+    DISPLAY_EVENT_ENROLL_PLACE_AGAIN,
+    DISPLAY_EVENT_ENROLL_STORED,      // param: stored ID
+    DISPLAY_EVENT_ENROLL_FAILED,      // param: fp_enroll_error_t
+    DISPLAY_EVENT_SET_CONTRAST        // param: contrast 0-255
 } display_event_t;
 
+/* Queue item: event plus optional parameter */
+typedef struct {
+    display_event_t event;
+    uint16_t param;
+} display_msg_t;
+
 /* UI states */
 typedef enum {
     UI_STATE_IDLE = 0,
     UI_STATE_DOOR_ANIMATION,
     UI_STATE_FINGERPRINT,
+    UI_STATE_ENROLL,
     UI_STATE_ERROR
 } ui_state_t;
 
@@ -36,6 +49,21 @@ typedef enum {
     DOOR_CLOSING
 } DoorDirection_t;
 
+/* Door animation: one keyframe per 0.05 rad from closed to ~90 degrees */
+#define DOOR_KEYFRAMES          33
+
+/* 1 = project the door with cosf/sinf every frame (render time reference) */
+#ifndef DOOR_FLOAT_REFERENCE
+#define DOOR_FLOAT_REFERENCE    0
+#endif
+
+/* Door animation render time (drawing only, measured with DWT) */
+typedef struct {
+    uint32_t frames;
+    uint32_t last_us;
+    uint32_t max_us;
+} display_render_stats_t;
+
 /* Function prototypes */
 
 /**
@@ -49,10 +77,35 @@ void DisplayTask_Init(void);
  */
 void DisplayTask_Send(display_event_t event);
 
+/**
+ * @brief Send event with a parameter to display task
+ * @param event: Event to send
+ * @param param: Event parameter (ID, error code...)
+ */
+void DisplayTask_SendParam(display_event_t event, uint16_t param);
+
 /**
  * @brief Get current UI state
  * @retval Current UI state
  */
 ui_state_t DisplayTask_GetState(void);
 
+/**
+ * @brief Change panel contrast (applied by the display task)
+ * @param contrast: 0x00 (dim) to 0xFF (bright)
+ */
+void DisplayTask_SetContrast(uint8_t contrast);
+
+/**
+ * @brief Get last requested contrast
+ * @retval Contrast 0-255
+ */
+uint8_t DisplayTask_GetContrast(void);
+
+/**
+ * @brief Get door animation render timing
+ * @retval Copy of the render statistics
+ */
+display_render_stats_t DisplayTask_GetRenderStats(void);
+
 #endif /* DISPLAY_TASK_H */
@@ -29,6 +29,12 @@ as608_status_t AS608_Search(uint16_t *id);
 uint16_t AS608_FindFreeID(uint16_t max_id);
 as608_status_t AS608_RegModel(void);
 as608_status_t AS608_StoreChar(uint8_t buffer, uint16_t page_id);
+
+/* Callback por cada paquete de datos recibido del sensor (<0 aborta) */
+typedef int (*as608_data_cb_t)(const uint8_t *data, uint16_t len, void *ctx);
+
+/* Sube la imagen del ImageBuffer paquete a paquete, sin guardarla entera */
+as608_status_t AS608_UpImage(as608_data_cb_t cb, void *ctx);
 //as608_status_t AS608
 
 
@@ -41,6 +47,7 @@ as608_status_t AS608_StoreChar(uint8_t buffer, uint16_t page_id);
 #define AS608_CMD_SEARCH       0x04
 #define AS608_CMD_REG_MODEL    0x05
 #define AS608_CMD_STORE_CHAR   0x06
+#define AS608_CMD_UP_IMAGE     0x0A
 
 #define AS608_CMD_READ_INDEX   0x1F
 
@@ -49,6 +56,11 @@ as608_status_t AS608_StoreChar(uint8_t buffer, uint16_t page_id);
 
 #define AS608_TX_TIMEOUT_MS   10
 #define AS608_RX_TIMEOUT_MS  3000
+#define AS608_DATA_TIMEOUT_MS 500
+
+/* Imagen 256x288 a 4 bits/píxel, en paquetes de datos de hasta 128 bytes */
+#define AS608_IMAGE_SIZE      (256 * 288 / 2)
+#define AS608_DATA_PKT_MAX    128
 
 #define AS608_ID_MIN     1
 #define AS608_ID_MAX     127
@@ -15,16 +15,78 @@
 
 #include "fingerprint.h"
 
+// Intervalo mínimo entre eventos mientras el dedo sigue apoyado
+#define FP_DUPLICATE_QUIET_MS  3000
+#define FP_IDLE_POLL_MS        5000
+#define FP_LIFT_POLL_MS        100
+
+// Enrolamiento: sondeo rápido del sensor y timeout por paso
+#define FP_ENROLL_POLL_MS          100
+#define FP_ENROLL_STEP_TIMEOUT_MS  10000
+
+// Espera máxima para dejar un evento en la cola de CANTask (ventana de ACK llena)
+#define FP_EVENT_SEND_MS       1000
+
+// Subir la imagen capturada a la RPi cuando una huella es rechazada
+#define FP_IMAGE_UPLOAD_ON_REJECT  1
+
+typedef enum {
+    FP_EVT_AUTH = 0,
+    FP_EVT_ENROLL
+} fp_event_kind_t;
+
+// Progreso del enrolamiento (se envía a la pantalla y por CAN)
+typedef enum {
+    FP_ENROLL_PLACE_FINGER = 0,
+    FP_ENROLL_LIFT,
+    FP_ENROLL_PLACE_AGAIN,
+    FP_ENROLL_STORED,
+    FP_ENROLL_FAILED
+} fp_enroll_step_t;
+
+typedef enum {
+    FP_ENROLL_ERR_NONE = 0,
+    FP_ENROLL_ERR_TIMEOUT,
+    FP_ENROLL_ERR_CANCELLED,
+    FP_ENROLL_ERR_SENSOR,     // GetImage falló (UART o sensor)
+    FP_ENROLL_ERR_IMAGE,      // Img2Tz: imagen de mala calidad
+    FP_ENROLL_ERR_MISMATCH,   // RegModel: las dos capturas no coinciden
+    FP_ENROLL_ERR_DB_FULL,
+    FP_ENROLL_ERR_STORE
+} fp_enroll_error_t;
+
 typedef struct {
+    fp_event_kind_t kind;
     as608_status_t status;
     uint16_t id;
+    uint8_t step;    // fp_enroll_step_t si kind == FP_EVT_ENROLL
+    uint8_t error;   // fp_enroll_error_t
 } fingerprint_event_t;
 
+typedef struct {
+    uint32_t scans;
+    uint32_t matches;
+    uint32_t rejections;
+    uint32_t duplicates_suppressed;
+    uint32_t events_dropped;      // cola de eventos llena tras FP_EVENT_SEND_MS
+    uint32_t image_uploads;
+    uint32_t image_errors;
+    uint32_t image_bytes_per_s;   // última subida completa
+    uint32_t uart_overflows;      // bytes del sensor perdidos con el buffer de RX lleno
+} fingerprint_stats_t;
+
 void FingerprintTask_Init(void);
 QueueHandle_t FingerprintTask_GetQueue(void);
 QueueHandle_t FingerprintTask_GetConfirmQueue(void);
+fingerprint_stats_t FingerprintTask_GetStats(void);
+void FingerprintTask_SetQuietInterval(uint32_t quiet_ms);
+void FingerprintTask_SetImageUpload(uint8_t on_reject);
+uint32_t FingerprintTask_GetQuietInterval(void);
+uint8_t FingerprintTask_GetImageUpload(void);
 void Fingerprint_RequestEnroll(void);
-static volatile uint8_t enroll_requested = 0;
+void Fingerprint_RequestEnrollFromISR(void);
+void Fingerprint_CancelEnroll(void);
+void Fingerprint_RequestImageUpload(void);
 
 
 
@@ -0,0 +1,70 @@
+/*
+ * fw_image.h
+ *
+ *  Mapa de flash y formato de la imagen, compartidos por la aplicación
+ *  (fw_update.c) y el cargador (Loader/loader.c). Sin HAL ni FreeRTOS:
+ *  fw_image.c se compila en los dos.
+ *
+ *  Sector  0      0x08000000   16 KB   cargador
+ *  Sectores 1-7   0x08004000  496 KB   aplicación (STM32F407VGTX_FLASH.ld)
+ *  Sectores 8-11  0x08080000  512 KB   staging; cabecera en los últimos 32 bytes
+ *
+ *  La aplicación escribe la imagen y la cabecera (COMMIT) y, en ACTIVATE,
+ *  la palabra activate antes de reiniciar. El cargador copia y verifica en
+ *  el arranque y solo entonces escribe installed: si se corta la
+ *  alimentación a mitad de la copia, el siguiente arranque la repite.
+ */
+
+#ifndef INC_FW_IMAGE_H_
+#define INC_FW_IMAGE_H_
+
+#include <stdint.h>
+
+#define FW_LOADER_BASE          0x08000000UL    // sector 0
+#define FW_LOADER_SIZE          0x4000UL
+#define FW_APP_BASE             0x08004000UL    // sectores 1-7
+#define FW_APP_FIRST_SECTOR     1
+#define FW_APP_SECTORS          7
+#define FW_APP_SIZE             0x7C000UL
+#define FW_STAGE_BASE           0x08080000UL    // sectores 8-11
+#define FW_STAGE_FIRST_SECTOR   8
+#define FW_STAGE_SECTORS        4
+#define FW_STAGE_SIZE           0x80000UL
+#define FW_HEADER_ADDR          (FW_STAGE_BASE + FW_STAGE_SIZE - sizeof(fw_header_t))
+#define FW_MAX_IMAGE            FW_APP_SIZE
+
+#define FW_HEADER_MAGIC         0x46574F4BU     // "FWOK"
+#define FW_ACTIVATE_MAGIC       0x41435456U     // "ACTV"
+#define FW_INSTALLED_MAGIC      0x494E5354U     // "INST"
+#define FW_WORD_ERASED          0xFFFFFFFFU
+
+/* SRAM1 + SRAM2: la pila inicial de la imagen tiene que caer aquí */
+#define FW_SRAM_BASE            0x20000000UL
+#define FW_SRAM_END             0x20020000UL
+
+/*
+ * Cabecera al final del staging. Cada palabra se programa una sola vez
+ * desde borrado, en orden: magic..check en COMMIT, activate en ACTIVATE
+ * (aplicación), installed tras copiar y verificar (cargador).
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t size;
+    uint32_t crc;
+    uint32_t check;         // ~magic
+    uint32_t activate;
+    uint32_t installed;
+    uint32_t reserved[2];
+} fw_header_t;
+
+/* CRC-32 de zlib (polinomio 0xEDB88320) */
+uint32_t FW_Image_Crc32(uint32_t crc, const uint8_t *data, uint32_t len);
+
+/* Pila inicial en SRAM y Reset_Handler (Thumb) dentro de FW_APP_BASE + size */
+uint8_t FW_Image_VectorsValid(const uint32_t *vectors, uint32_t size);
+
+/* Cabecera escrita, CRC del staging correcto y vectores de aplicación.
+ * Devuelve la cabecera o NULL */
+const fw_header_t *FW_Image_StageValid(void);
+
+#endif /* INC_FW_IMAGE_H_ */
@@ -0,0 +1,83 @@
+/*
+ * fw_update.h
+ *
+ *  Actualización de firmware por CAN.
+ *
+ *  El STM32F407VG tiene un solo banco de flash (1 MB), así que no hay banco
+ *  inactivo: la imagen nueva se escribe en la zona de staging (sectores
+ *  8-11) mientras la aplicación sigue funcionando, y la copia sobre la
+ *  aplicación la hace el cargador del sector 0 en el siguiente arranque
+ *  (mapa y cabecera en fw_image.h). Un corte de alimentación durante la
+ *  copia no deja el equipo sin aplicación: el cargador la repite al volver.
+ *
+ *  Control (RPi -> STM32, CAN_ID_FW_CONTROL):
+ *    BEGIN    [1, tamaño (24 bits LE), CRC-32 de la imagen (32 bits LE)]
+ *    COMMIT   [2]      comprueba el CRC de toda la imagen y la marca válida
+ *    ABORT    [3]
+ *    ACTIVATE [4]      marca la imagen validada para el cargador y reinicia
+ *  Estado (STM32 -> RPi, CAN_ID_FW_STATUS): [cmd, estado, valor (32 bits LE)]
+ *    READY tras BEGIN (staging borrado), BLOCK_OK / BLOCK_ERR con el offset
+ *    de cada bloque, y la respuesta a COMMIT / ABORT / ACTIVATE.
+ *
+ *  Datos (ISO-TP, CAN_ID_TP_FW -> flow control en CAN_ID_TP_FW_FC):
+ *    [offset (32 bits LE), CRC-32 de los datos (32 bits LE), datos]
+ *  con hasta FW_BLOCK_DATA bytes, offset múltiplo de 4. El bloque se
+ *  programa en la tarea FWUPD mientras llega el siguiente: la RPi puede
+ *  tener FW_WINDOW bloques sin BLOCK_OK.
+ *
+ *  Paradas de la CPU: con un solo banco, borrar o programar flash detiene
+ *  la lectura de instrucciones (también las ISR). Borrar los 4 sectores de
+ *  128 KB lleva 4-8 s con todo parado, por eso se hace en BEGIN, antes de
+ *  READY, y la RPi no envía nada mientras. Cada palabra programada para
+ *  la CPU ~16 µs: unos 2 ms por bloque, menos que lo que tarda en llegar
+ *  el siguiente (~20 ms a 500 kbit/s). BEGIN y ACTIVATE se rechazan
+ *  (FW_ERR_STATE) si la puerta no está cerrada y parada. Tras ACTIVATE el
+ *  cargador borra los sectores 1-7 y copia la imagen (~3-5 s sin
+ *  aplicación) antes de arrancarla.
+ */
+
+#ifndef INC_FW_UPDATE_H_
+#define INC_FW_UPDATE_H_
+
+#include <stdint.h>
+#include "can_bsp.h"
+#include "fw_image.h"
+
+#define FW_BLOCK_HDR            8
+#define FW_BLOCK_DATA           504             // + cabecera = bloque del pool ISO-TP
+#define FW_WINDOW               2
+
+#define FW_CMD_BEGIN            0x01
+#define FW_CMD_COMMIT           0x02
+#define FW_CMD_ABORT            0x03
+#define FW_CMD_ACTIVATE         0x04
+#define FW_EVT_READY            0x10
+#define FW_EVT_BLOCK_OK         0x11
+#define FW_EVT_BLOCK_ERR        0x12
+
+#define FW_OK                   0x00
+#define FW_ERR_STATE            0x01    // orden fuera de secuencia o puerta no cerrada/parada
+#define FW_ERR_SIZE             0x02
+#define FW_ERR_CRC              0x03
+#define FW_ERR_FLASH            0x04    // fallo al borrar, programar o releer
+#define FW_ERR_BUSY             0x05    // ventana llena
+#define FW_ERR_RANGE            0x06    // offset fuera de la imagen
+#define FW_ERR_IMAGE            0x07    // vectores que no son de una aplicación para FW_APP_BASE
+#define FW_ERR_INSTALLED        0x08    // el cargador ya instaló esta imagen
+
+typedef struct {
+    uint32_t images;            // COMMIT correctos
+    uint32_t blocks;
+    uint32_t block_errors;
+    uint32_t last_bytes_per_s;  // BEGIN -> COMMIT de la última imagen
+} fw_update_stats_t;
+
+/* Registra el canal ISO-TP y crea la tarea. Antes de CAN_BSP_Init */
+void FW_Update_Init(void);
+
+/* Handler de la tabla de despacho para CAN_ID_FW_CONTROL */
+void FW_Update_OnControl(const can_bsp_msg_t *msg, void *ctx);
+
+fw_update_stats_t FW_Update_GetStats(void);
+
+#endif /* INC_FW_UPDATE_H_ */
@@ -13,15 +13,35 @@
 #include <stdint.h>
 #include <stddef.h>
 
+/*
+ * Buffer circular de recepción (DMA). Debe cubrir el peor bloqueo del
+ * lector: durante UpImage, CAN_TP_StreamWrite espera hasta
+ * CAN_TP_FC_TIMEOUT_MS (1000 ms) un FC, y a 57600 baudios llegan ~5760
+ * bytes en ese tiempo. Potencia de 2.
+ */
+#define UART_BSP_RX_RING_SIZE  8192
+
+typedef struct {
+    uint32_t rx_bytes;
+    uint32_t rx_overflows;    // el DMA dio la vuelta sobre bytes sin leer
+    uint32_t rx_lost_bytes;
+    uint32_t rx_errors;       // ruido/trama/overrun: recepción rearmada
+} uart_bsp_stats_t;
+
 /* Inicialización del BSP UART */
 void uart_bsp_init(void);
 
+/* Descarta los bytes pendientes de recepción */
+void uart_bsp_flush(void);
+
 /* Envío bloqueante */
 int uart_bsp_tx(const uint8_t *data, size_t len, uint32_t timeout_ms);
 
-/* Recepción bloqueante */
+/* Recepción bloqueante (la tarea duerme hasta que llegan los datos) */
 int uart_bsp_rx(uint8_t *data, size_t len, uint32_t timeout_ms);
 
+uart_bsp_stats_t uart_bsp_get_stats(void);
+
 
 
 #endif /* INC_BSP_UART_BSP_H_ */
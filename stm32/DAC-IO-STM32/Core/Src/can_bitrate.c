@@ -0,0 +1,183 @@
+/*
+ * can_bitrate.c
+ *
+ *  Cambio de bitrate en caliente con vuelta atrás si la RPi no confirma.
+ */
+
+#include "can_bitrate.h"
+#include "can_task.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+
+typedef enum {
+    BR_IDLE,
+    BR_SWITCHING,       // respuesta enviada, esperando para cambiar
+    BR_TRIAL            // bitrate nuevo, esperando CONFIRM
+} br_state_t;
+
+static TimerHandle_t    br_timer;
+static TaskHandle_t     br_task;
+static volatile br_state_t br_state;
+static can_bsp_timing_t br_old;
+static can_bsp_timing_t br_new;
+
+static void br_reply(uint8_t cmd, uint8_t status, const can_bsp_timing_t *t)
+{
+    uint32_t kbps = t->bitrate / 1000;
+    uint8_t data[6];
+
+    data[0] = cmd;
+    data[1] = status;
+    data[2] = kbps & 0xFF;
+    data[3] = kbps >> 8;
+    data[4] = t->sample_point & 0xFF;
+    data[5] = t->sample_point >> 8;
+    CAN_BSP_Send(CAN_ID_BITRATE_RESPONSE, data, sizeof(data));
+}
+
+/*
+ * Cambia los dos controladores a t. Si alguno falla, los dos vuelven a
+ * back: los buses no se quedan con bitrates distintos. SetTiming con error
+ * puede dejar el controlador parado; Restart lo vuelve a arrancar.
+ */
+static uint8_t br_apply(const can_bsp_timing_t *t, const can_bsp_timing_t *back)
+{
+    if (CAN_BSP_SetTiming(CAN_BSP_BUS1, t) == CAN_BSP_OK &&
+        CAN_BSP_SetTiming(CAN_BSP_BUS2, t) == CAN_BSP_OK)
+        return 1;
+
+    for (uint8_t bus = CAN_BSP_BUS1; bus <= CAN_BSP_BUS2; bus++)
+    {
+        CAN_BSP_SetTiming(bus, back);
+        CAN_BSP_Restart(bus);
+    }
+
+    return 0;
+}
+
+// Stop/Init del bxCAN esperan activamente: nada de eso en el daemon de timers
+static void br_timer_cb(TimerHandle_t timer)
+{
+    xTaskNotifyGive(br_task);
+}
+
+static void CAN_BitrateTask(void *arg)
+{
+    for (;;)
+    {
+        br_state_t state;
+
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // CONFIRM puede llegar a la vez: solo uno de los dos sale de TRIAL
+        taskENTER_CRITICAL();
+        state = br_state;
+        if (state == BR_TRIAL)
+            br_state = BR_IDLE;
+        taskEXIT_CRITICAL();
+
+        if (state == BR_SWITCHING)
+        {
+            if (br_apply(&br_new, &br_old))
+            {
+                br_state = BR_TRIAL;
+                xTimerChangePeriod(br_timer, pdMS_TO_TICKS(CAN_BITRATE_CONFIRM_MS), pdMS_TO_TICKS(10));
+            }
+            else
+            {
+                br_state = BR_IDLE;
+                br_reply(CAN_BITRATE_CMD_FALLBACK, CAN_BITRATE_ERR_APPLY, &br_old);
+            }
+        }
+        else if (state == BR_TRIAL)
+        {
+            // Sin CONFIRM: volver al bitrate anterior y avisar
+            br_apply(&br_old, &br_old);
+            br_reply(CAN_BITRATE_CMD_FALLBACK, CAN_BITRATE_OK, &br_old);
+        }
+    }
+}
+
+void CAN_Bitrate_OnRequest(const can_bsp_msg_t *msg, void *ctx)
+{
+    can_bsp_timing_t current;
+    uint8_t cmd;
+
+    if (msg->dlc < 1)
+        return;
+
+    cmd = msg->data[0];
+    CAN_BSP_GetTiming(CAN_BSP_BUS1, &current);
+
+    switch (cmd)
+    {
+    case CAN_BITRATE_CMD_PROPOSE:
+    {
+        uint32_t kbps;
+        uint16_t sp;
+
+        if (msg->dlc < 5)
+            return;
+
+        if (br_state != BR_IDLE)
+        {
+            br_reply(cmd, CAN_BITRATE_ERR_BUSY, &current);
+            return;
+        }
+
+        kbps = msg->data[1] | ((uint32_t)msg->data[2] << 8);
+        sp   = msg->data[3] | ((uint16_t)msg->data[4] << 8);
+
+        if (CAN_BSP_CalcTiming(kbps * 1000, sp, &br_new) != CAN_BSP_OK)
+        {
+            br_reply(cmd, CAN_BITRATE_ERR_INVALID, &current);
+            return;
+        }
+
+        // La respuesta sale al bitrate actual antes del cambio
+        br_old = current;
+        br_state = BR_SWITCHING;
+        br_reply(cmd, CAN_BITRATE_OK, &br_new);
+        xTimerChangePeriod(br_timer, pdMS_TO_TICKS(CAN_BITRATE_SWITCH_MS), pdMS_TO_TICKS(10));
+        break;
+    }
+
+    case CAN_BITRATE_CMD_CONFIRM:
+        taskENTER_CRITICAL();
+        if (br_state == BR_TRIAL)
+        {
+            br_state = BR_IDLE;
+            taskEXIT_CRITICAL();
+            xTimerStop(br_timer, pdMS_TO_TICKS(10));
+            br_reply(cmd, CAN_BITRATE_OK, &current);
+        }
+        else
+        {
+            taskEXIT_CRITICAL();
+            br_reply(cmd, CAN_BITRATE_ERR_NOT_PENDING, &current);
+        }
+        break;
+
+    case CAN_BITRATE_CMD_QUERY:
+        br_reply(cmd, CAN_BITRATE_OK, &current);
+        break;
+
+    default:
+        break;
+    }
+}
+
+uint32_t CAN_Bitrate_GetKbps(void)
+{
+    can_bsp_timing_t t;
+
+    CAN_BSP_GetTiming(CAN_BSP_BUS1, &t);
+    return t.bitrate / 1000;
+}
+
+void CAN_Bitrate_Init(void)
+{
+    br_timer = xTimerCreate("bitrate", pdMS_TO_TICKS(CAN_BITRATE_SWITCH_MS), pdFALSE, NULL, br_timer_cb);
+    xTaskCreate(CAN_BitrateTask, "CANBR", 128, NULL, tskIDLE_PRIORITY + 1, &br_task);
+}
@@ -9,108 +9,802 @@
 extern CAN_HandleTypeDef hcan1;  // viene de can.c (MX_CAN1_Init)
 extern CAN_HandleTypeDef hcan2;  // viene de can.c (MX_CAN1_Init)
 
-void CAN_BSP_Init(void)
+#define CAN_BSP_ERR_IT  (CAN_IT_ERROR_WARNING | CAN_IT_ERROR_PASSIVE | CAN_IT_BUSOFF | CAN_IT_ERROR)
+
+#define CAN_BSP_RX_IT   (CAN_IT_RX_FIFO0_MSG_PENDING | CAN_IT_RX_FIFO1_MSG_PENDING | \
+                         CAN_IT_RX_FIFO0_OVERRUN | CAN_IT_RX_FIFO1_OVERRUN)
+
+typedef struct {
+    uint16_t id;
+    uint16_t mask;      // 0x7FF = ID exacto
+    uint8_t  fifo;
+} can_bsp_filter_t;
+
+static can_bsp_filter_t filters[CAN_BSP_MAX_FILTERS];
+static uint8_t          num_filters;
+static uint8_t          filters_overflow;
+
+uint32_t CAN_BSP_Now(void)
+{
+    return DWT->CYCCNT;
+}
+
+uint32_t CAN_BSP_CyclesToUs(uint32_t cycles)
+{
+    return cycles / (SystemCoreClock / 1000000);
+}
+
+static can_bsp_status_t can_bsp_add_mask(uint16_t id, uint16_t mask, uint8_t fifo)
+{
+    id &= mask;
+
+    for (uint8_t i = 0; i < num_filters; i++)
+        if (filters[i].id == id && filters[i].mask == mask && filters[i].fifo == fifo)
+            return CAN_BSP_OK;
+
+    if (num_filters >= CAN_BSP_MAX_FILTERS)
+    {
+        filters_overflow = 1;
+        return CAN_BSP_ERROR;
+    }
+
+    filters[num_filters].id = id;
+    filters[num_filters].mask = mask;
+    filters[num_filters].fifo = fifo;
+    num_filters++;
+
+    return CAN_BSP_OK;
+}
+
+can_bsp_status_t CAN_BSP_AddFilter(uint32_t std_id, uint8_t fifo)
+{
+    if (std_id > 0x7FF || fifo > CAN_BSP_FIFO1)
+        return CAN_BSP_ERROR;
+
+    return can_bsp_add_mask(std_id, 0x7FF, fifo);
+}
+
+can_bsp_status_t CAN_BSP_AddFilterRange(uint32_t first_id, uint32_t last_id, uint8_t fifo)
+{
+    if (first_id > last_id || last_id > 0x7FF || fifo > CAN_BSP_FIFO1)
+        return CAN_BSP_ERROR;
+
+    // Partir el rango en bloques de 2^k IDs alineados a 2^k
+    while (first_id <= last_id)
+    {
+        uint32_t size = 1;
+
+        while ((first_id & (size * 2 - 1)) == 0 && first_id + size * 2 - 1 <= last_id && size < 0x800)
+            size *= 2;
+
+        if (can_bsp_add_mask(first_id, 0x7FF & ~(size - 1), fifo) != CAN_BSP_OK)
+            return CAN_BSP_ERROR;
+
+        first_id += size;
+    }
+
+    return CAN_BSP_OK;
+}
+
+/*
+ * r[] en formato de registro de 16 bits (STID << 5, RTR e IDE a 0):
+ * lista -> 4 IDs; máscara -> pares (id, máscara).
+ */
+static void can_bsp_write_bank(uint8_t bank, uint32_t mode, uint8_t fifo, const uint16_t r[4])
+{
+    CAN_FilterTypeDef filter = {0};
+
+    filter.FilterBank = bank;
+    filter.FilterMode = mode;
+    filter.FilterScale = CAN_FILTERSCALE_16BIT;
+    filter.FilterIdLow = r[0];
+    filter.FilterMaskIdLow = r[1];
+    filter.FilterIdHigh = r[2];
+    filter.FilterMaskIdHigh = r[3];
+    filter.FilterFIFOAssignment = (fifo == CAN_BSP_FIFO1) ? CAN_FILTER_FIFO1 : CAN_FILTER_FIFO0;
+    filter.FilterActivation = ENABLE;
+    filter.SlaveStartFilterBank = CAN_BSP_SLAVE_BANK;
+    HAL_CAN_ConfigFilter(&hcan1, &filter);
+}
+
+static void can_bsp_accept_all(uint8_t bank)
 {
     CAN_FilterTypeDef filter = {0};
 
-	 filter.FilterBank = 0;
-     filter.FilterMode = CAN_FILTERMODE_IDMASK;
-     filter.FilterScale = CAN_FILTERSCALE_32BIT;
-     filter.FilterIdHigh = 0x0000;
-     filter.FilterIdLow = 0x0000;
-     filter.FilterMaskIdHigh = 0x0000;
-     filter.FilterMaskIdLow = 0x0000;
-     filter.FilterFIFOAssignment = CAN_FILTER_FIFO0;
-     //filter.FilterFIFOAssignment = CAN_RX_FIFO0;
-     filter.FilterActivation = ENABLE;
-     filter.SlaveStartFilterBank = 14;
-     HAL_CAN_ConfigFilter(&hcan1, &filter);
-     filter.FilterBank = 14;
-     HAL_CAN_ConfigFilter(&hcan1, &filter);
+    filter.FilterBank = bank;
+    filter.FilterMode = CAN_FILTERMODE_IDMASK;
+    filter.FilterScale = CAN_FILTERSCALE_32BIT;
+    filter.FilterFIFOAssignment = CAN_FILTER_FIFO0;
+    filter.FilterActivation = ENABLE;
+    filter.SlaveStartFilterBank = CAN_BSP_SLAVE_BANK;
+    HAL_CAN_ConfigFilter(&hcan1, &filter);
+}
+
+static uint8_t can_bsp_banks_needed(void)
+{
+    uint8_t banks = 0;
+
+    for (uint8_t fifo = CAN_BSP_FIFO0; fifo <= CAN_BSP_FIFO1; fifo++)
+    {
+        uint8_t n_list = 0, n_mask = 0;
+
+        for (uint8_t i = 0; i < num_filters; i++)
+        {
+            if (filters[i].fifo != fifo)
+                continue;
+            if (filters[i].mask == 0x7FF)
+                n_list++;
+            else
+                n_mask++;
+        }
+
+        banks += (n_list + 3) / 4 + (n_mask + 1) / 2;
+    }
+
+    return banks;
+}
+
+// Escribe la tabla a partir de first_bank; devuelve el número de bancos usados
+static uint8_t can_bsp_config_filters(uint8_t first_bank)
+{
+    uint8_t bank = first_bank;
+
+    for (uint8_t fifo = CAN_BSP_FIFO0; fifo <= CAN_BSP_FIFO1; fifo++)
+    {
+        for (uint8_t exact = 0; exact <= 1; exact++)
+        {
+            uint16_t r[4];
+            uint8_t  n = 0;
+            uint8_t  per_bank = exact ? 4 : 2;
+
+            for (uint8_t i = 0; i < num_filters; i++)
+            {
+                const can_bsp_filter_t *f = &filters[i];
+
+                if (f->fifo != fifo || (f->mask == 0x7FF) != exact)
+                    continue;
+
+                if (exact)
+                {
+                    r[n] = f->id << 5;
+                }
+                else
+                {
+                    r[n * 2]     = f->id << 5;
+                    r[n * 2 + 1] = (f->mask << 5) | 0x18;   // exigir RTR = 0, IDE = 0
+                }
+
+                if (++n == per_bank)
+                {
+                    can_bsp_write_bank(bank++, exact ? CAN_FILTERMODE_IDLIST : CAN_FILTERMODE_IDMASK, fifo, r);
+                    n = 0;
+                }
+            }
+
+            if (n > 0)
+            {
+                // Completar el banco repitiendo la última entrada
+                for (uint8_t k = n; k < per_bank; k++)
+                {
+                    if (exact)
+                        r[k] = r[n - 1];
+                    else
+                    {
+                        r[k * 2]     = r[(n - 1) * 2];
+                        r[k * 2 + 1] = r[(n - 1) * 2 + 1];
+                    }
+                }
+                can_bsp_write_bank(bank++, exact ? CAN_FILTERMODE_IDLIST : CAN_FILTERMODE_IDMASK, fifo, r);
+            }
+        }
+    }
+
+    return bank - first_bank;
+}
+
+void CAN_BSP_Init(void)
+{
+    if (num_filters == 0 || filters_overflow ||
+        can_bsp_banks_needed() > CAN_BSP_SLAVE_BANK)
+    {
+        // Sin tabla válida: aceptar todo en ambos controladores
+        can_bsp_accept_all(0);
+        can_bsp_accept_all(CAN_BSP_SLAVE_BANK);
+    }
+    else
+    {
+        can_bsp_config_filters(0);
+        can_bsp_config_filters(CAN_BSP_SLAVE_BANK);
+    }
+
+    // Contador de ciclos: latencia de los mailboxes y marcas de tiempo RX
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+#if CAN_BSP_USE_TTCM
+    // Todavía en modo init tras MX_CANx_Init: TTCM solo se puede fijar aquí.
+    // Init.TimeTriggeredMode lo conserva si CAN_BSP_SetTiming reinicializa.
+    hcan1.Init.TimeTriggeredMode = ENABLE;
+    hcan2.Init.TimeTriggeredMode = ENABLE;
+    SET_BIT(hcan1.Instance->MCR, CAN_MCR_TTCM);
+    SET_BIT(hcan2.Instance->MCR, CAN_MCR_TTCM);
+#endif
+
      // Arrancar CAN
 	HAL_CAN_Start(&hcan1);
 	HAL_CAN_Start(&hcan2);
-    // Activar interrupciones RX
-    HAL_CAN_ActivateNotification(&hcan1, CAN_IT_RX_FIFO0_MSG_PENDING);
-    HAL_CAN_ActivateNotification(&hcan2, CAN_IT_RX_FIFO0_MSG_PENDING);
+    // Activar interrupciones RX, de mailbox vacío (rellena desde la cola TX)
+    // y de cambio de estado de error (SCE)
+    HAL_CAN_ActivateNotification(&hcan1, CAN_BSP_RX_IT | CAN_BSP_ERR_IT | CAN_IT_TX_MAILBOX_EMPTY);
+    HAL_CAN_ActivateNotification(&hcan2, CAN_BSP_RX_IT | CAN_BSP_ERR_IT | CAN_IT_TX_MAILBOX_EMPTY);
 
 }
 
 
-can_bsp_status_t CAN_BSP_Send(uint32_t std_id,const uint8_t *data, uint8_t len)
+/* Una cola por controlador: en modo redundante CAN2 también transmite */
+typedef struct {
+    can_bsp_msg_t      ring[CAN_BSP_TX_BANDS][CAN_BSP_TX_BAND_LEN];
+    uint8_t            head[CAN_BSP_TX_BANDS];
+    uint8_t            tail[CAN_BSP_TX_BANDS];
+    uint32_t           pending;     // bit n = banda n con tramas
+    can_bsp_tx_stats_t stats;
+    uint32_t           start[3];    // DWT->CYCCNT al cargar cada mailbox
+} can_bsp_tx_t;
+
+static can_bsp_tx_t     tx[2];
+static volatile uint8_t tx_active = CAN_BSP_BUS1;
+static volatile uint8_t redundancy = CAN_BSP_REDUNDANCY_NONE;
+
+static CAN_HandleTypeDef *can_bsp_handle(uint8_t bus)
+{
+    return (bus == CAN_BSP_BUS2) ? &hcan2 : &hcan1;
+}
+
+/*
+ * Pasa tramas de la cola a los mailboxes libres, banda más prioritaria
+ * primero. Se llama con las interrupciones enmascaradas o desde la ISR de TX.
+ */
+static void can_bsp_tx_pump(uint8_t bus)
 {
+    CAN_HandleTypeDef *hcan = can_bsp_handle(bus);
+    can_bsp_tx_t *t = &tx[bus];
     CAN_TxHeaderTypeDef txHeader;
     uint32_t txMailbox;
 
-    if (len > 8) return CAN_BSP_ERROR;
-
-    txHeader.StdId = std_id;
     txHeader.ExtId = 0;
     txHeader.IDE = CAN_ID_STD;
     txHeader.RTR = CAN_RTR_DATA;
-    txHeader.DLC = len;
-    if (HAL_CAN_GetTxMailboxesFreeLevel(&hcan1) == 0)
-        return CAN_BSP_BUSY;
-    if (HAL_CAN_AddTxMessage(&hcan1, &txHeader, data, &txMailbox) != HAL_OK)
+    txHeader.TransmitGlobalTime = DISABLE;
+
+    while (t->pending != 0 && HAL_CAN_GetTxMailboxesFreeLevel(hcan) > 0)
+    {
+        uint32_t band = __builtin_ctz(t->pending);
+        can_bsp_msg_t *msg = &t->ring[band][t->tail[band] & (CAN_BSP_TX_BAND_LEN - 1)];
+
+        txHeader.StdId = msg->id;
+        txHeader.DLC = msg->dlc;
+
+        if (HAL_CAN_AddTxMessage(hcan, &txHeader, msg->data, &txMailbox) != HAL_OK)
+            break;
+
+        t->start[__builtin_ctz(txMailbox)] = DWT->CYCCNT;
+
+        t->tail[band]++;
+        if (t->tail[band] == t->head[band])
+            t->pending &= ~(1UL << band);
+    }
+}
+
+// Llamar con las interrupciones enmascaradas
+static can_bsp_status_t can_bsp_tx_enqueue(uint8_t bus, uint32_t std_id, const uint8_t *data, uint8_t len)
+{
+    can_bsp_tx_t *t = &tx[bus];
+    uint32_t band = (std_id & 0x7FF) >> CAN_BSP_TX_BAND_SHIFT;
+    uint8_t used = t->head[band] - t->tail[band];
+    can_bsp_msg_t *msg;
+
+    if (used >= CAN_BSP_TX_BAND_LEN)
+    {
+        t->stats.overflows++;
         return CAN_BSP_BUSY; // cola llena
+    }
+
+    msg = &t->ring[band][t->head[band] & (CAN_BSP_TX_BAND_LEN - 1)];
+    msg->id = std_id;
+    msg->dlc = len;
+    for (uint8_t i = 0; i < len; i++)
+        msg->data[i] = data[i];
+
+    t->head[band]++;
+    t->pending |= 1UL << band;
+    t->stats.queued++;
+    if (used + 1 > t->stats.high_water)
+        t->stats.high_water = used + 1;
+
+    can_bsp_tx_pump(bus);
 
     return CAN_BSP_OK;
 }
 
-__weak void CAN_BSP_RxCallback(const can_bsp_msg_t *msg)
+can_bsp_status_t CAN_BSP_Send(uint32_t std_id,const uint8_t *data, uint8_t len)
+{
+    can_bsp_status_t status;
+
+    if (len > 8) return CAN_BSP_ERROR;
+
+    // Varias tareas encolan y la ISR de TX desencola: sección crítica corta
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    status = can_bsp_tx_enqueue(tx_active, std_id, data, len);
+    __set_PRIMASK(primask);
+
+    return status;
+}
+
+can_bsp_status_t CAN_BSP_SendOnBus(uint8_t bus, uint32_t std_id, const uint8_t *data, uint8_t len)
+{
+    can_bsp_status_t status;
+
+    if (len > 8 || bus > CAN_BSP_BUS2) return CAN_BSP_ERROR;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    status = can_bsp_tx_enqueue(bus, std_id, data, len);
+    __set_PRIMASK(primask);
+
+    return status;
+}
+
+uint8_t CAN_BSP_TxIdle(uint8_t bus)
+{
+    return tx[bus & 1].pending == 0 && HAL_CAN_GetTxMailboxesFreeLevel(can_bsp_handle(bus)) == 3;
+}
+
+can_bsp_status_t CAN_BSP_SendCritical(uint32_t std_id, const uint8_t *data, uint8_t len)
+{
+    can_bsp_status_t status;
+
+    if (len > 8) return CAN_BSP_ERROR;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    status = can_bsp_tx_enqueue(tx_active, std_id, data, len);
+
+    // Copia por el otro bus: basta con que una de las dos entre en cola
+    if (redundancy == CAN_BSP_REDUNDANCY_DUAL &&
+        can_bsp_tx_enqueue(tx_active ^ 1, std_id, data, len) == CAN_BSP_OK)
+        status = CAN_BSP_OK;
+
+    __set_PRIMASK(primask);
+
+    return status;
+}
+
+can_bsp_tx_stats_t CAN_BSP_GetTxStats(void)
+{
+    return CAN_BSP_GetBusTxStats(CAN_BSP_BUS1);
+}
+
+can_bsp_tx_stats_t CAN_BSP_GetBusTxStats(uint8_t bus)
+{
+    can_bsp_tx_stats_t copy;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    copy = tx[bus & 1].stats;
+    __set_PRIMASK(primask);
+
+    return copy;
+}
+
+void CAN_BSP_ResetTxLatency(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    for (uint8_t bus = 0; bus < 2; bus++)
+        for (uint8_t i = 0; i < 3; i++)
+            tx[bus].stats.mb_latency_max_us[i] = 0;
+    __set_PRIMASK(primask);
+}
+
+static void can_bsp_tx_done(CAN_HandleTypeDef *hcan, uint8_t mb, uint8_t ok)
+{
+    uint8_t bus = (hcan->Instance == CAN2) ? CAN_BSP_BUS2 : CAN_BSP_BUS1;
+    can_bsp_tx_t *t = &tx[bus];
+
+    if (ok)
+    {
+        // Incluye la espera de arbitraje y los reintentos tras errores
+        uint32_t us = CAN_BSP_CyclesToUs(DWT->CYCCNT - t->start[mb]);
+
+        t->stats.sent++;
+        t->stats.mb_latency_us[mb] = us;
+        if (us > t->stats.mb_latency_max_us[mb])
+            t->stats.mb_latency_max_us[mb] = us;
+    }
+    else
+    {
+        t->stats.aborted++;
+    }
+
+    can_bsp_tx_pump(bus);
+}
+
+void CAN_BSP_SetRedundancy(uint8_t mode)
+{
+    if (mode > CAN_BSP_REDUNDANCY_DUAL)
+        return;
+
+    redundancy = mode;
+
+    // Sin redundancia solo se usa CAN1: si estaba conmutado a CAN2, volver
+    if (mode == CAN_BSP_REDUNDANCY_NONE)
+        CAN_BSP_SetActiveBus(CAN_BSP_BUS1);
+}
+
+uint8_t CAN_BSP_GetRedundancy(void)
+{
+    return redundancy;
+}
+
+uint8_t CAN_BSP_GetActiveBus(void)
+{
+    return tx_active;
+}
+
+can_bsp_status_t CAN_BSP_SetActiveBus(uint8_t bus)
+{
+    uint8_t old;
+
+    if (bus > CAN_BSP_BUS2)
+        return CAN_BSP_ERROR;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    old = tx_active;
+    if (bus != old)
+    {
+        can_bsp_tx_t *from = &tx[old];
+
+        tx_active = bus;
+
+        // Lo que esperaba en la cola del bus caído sale por el nuevo
+        while (from->pending != 0)
+        {
+            uint32_t band = __builtin_ctz(from->pending);
+            can_bsp_msg_t *msg = &from->ring[band][from->tail[band] & (CAN_BSP_TX_BAND_LEN - 1)];
+
+            can_bsp_tx_enqueue(bus, msg->id, msg->data, msg->dlc);
+
+            from->tail[band]++;
+            if (from->tail[band] == from->head[band])
+                from->pending &= ~(1UL << band);
+        }
+    }
+
+    __set_PRIMASK(primask);
+
+    // Los mailboxes ya cargados del bus caído se abortan (reintentarían sin
+    // fin sin ACK). Esas tramas se pierden; los eventos de acceso las
+    // recuperan con su propia retransmisión.
+    if (bus != old)
+        HAL_CAN_AbortTxRequest(can_bsp_handle(old), CAN_TX_MAILBOX0 | CAN_TX_MAILBOX1 | CAN_TX_MAILBOX2);
+
+    return CAN_BSP_OK;
+}
+
+void HAL_CAN_TxMailbox0CompleteCallback(CAN_HandleTypeDef *hcan) { can_bsp_tx_done(hcan, 0, 1); }
+void HAL_CAN_TxMailbox1CompleteCallback(CAN_HandleTypeDef *hcan) { can_bsp_tx_done(hcan, 1, 1); }
+void HAL_CAN_TxMailbox2CompleteCallback(CAN_HandleTypeDef *hcan) { can_bsp_tx_done(hcan, 2, 1); }
+void HAL_CAN_TxMailbox0AbortCallback(CAN_HandleTypeDef *hcan)    { can_bsp_tx_done(hcan, 0, 0); }
+void HAL_CAN_TxMailbox1AbortCallback(CAN_HandleTypeDef *hcan)    { can_bsp_tx_done(hcan, 1, 0); }
+void HAL_CAN_TxMailbox2AbortCallback(CAN_HandleTypeDef *hcan)    { can_bsp_tx_done(hcan, 2, 0); }
+
+__weak void CAN_BSP_RxCallback(const can_bsp_msg_t *msgs, uint8_t count)
 {
     // vacío por defecto
 }
 
+__weak void CAN_BSP_RxUrgentCallback(const can_bsp_msg_t *msgs, uint8_t count)
+{
+    CAN_BSP_RxCallback(msgs, count);
+}
+
+static can_bsp_rx_stats_t rx_stats;
 
-void HAL_CAN_RxFifo0MsgPendingCallback(CAN_HandleTypeDef *hcan)
+can_bsp_rx_stats_t CAN_BSP_GetRxStats(void)
+{
+    can_bsp_rx_stats_t copy;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    copy = rx_stats;
+    __set_PRIMASK(primask);
+
+    return copy;
+}
+
+/*
+ * Supresión de duplicados en modo DUAL: una trama igual a otra llegada por
+ * el otro bus hace menos de CAN_BSP_DEDUP_MS es la copia redundante. Cada
+ * entrada empareja una sola copia, así que dos envíos legítimos iguales
+ * seguidos no se pierden. Las dos ISR RX tienen la misma prioridad.
+ */
+typedef struct {
+    uint32_t tick;
+    uint16_t id;        // 0xFFFF = ya emparejada
+    uint8_t  bus;
+    uint8_t  dlc;
+    uint8_t  data[8];
+} can_bsp_dedup_t;
+
+static can_bsp_dedup_t dedup[CAN_BSP_DEDUP_LEN];
+static uint8_t         dedup_next;
+
+static uint8_t can_bsp_rx_duplicate(uint8_t bus, const can_bsp_msg_t *msg)
+{
+    uint32_t now = HAL_GetTick();
+    can_bsp_dedup_t *e;
+
+    for (uint8_t i = 0; i < CAN_BSP_DEDUP_LEN; i++)
+    {
+        e = &dedup[i];
+
+        if (e->id != msg->id || e->bus == bus || e->dlc != msg->dlc ||
+            (now - e->tick) > CAN_BSP_DEDUP_MS)
+            continue;
+
+        uint8_t k = 0;
+        while (k < msg->dlc && e->data[k] == msg->data[k])
+            k++;
+
+        if (k == msg->dlc)
+        {
+            e->id = 0xFFFF;
+            return 1;
+        }
+    }
+
+    e = &dedup[dedup_next];
+    dedup_next = (dedup_next + 1) % CAN_BSP_DEDUP_LEN;
+    e->tick = now;
+    e->id = msg->id;
+    e->bus = bus;
+    e->dlc = msg->dlc;
+    for (uint8_t k = 0; k < msg->dlc; k++)
+        e->data[k] = msg->data[k];
+
+    return 0;
+}
+
+static void can_bsp_rx_deliver(uint32_t fifo, const can_bsp_msg_t *batch, uint8_t n)
+{
+    if (fifo == CAN_RX_FIFO1)
+        CAN_BSP_RxUrgentCallback(batch, n);
+    else
+        CAN_BSP_RxCallback(batch, n);
+}
+
+// Vacía el FIFO: una ráfaga se atiende con una interrupción, no una por trama
+static void can_bsp_rx_drain(CAN_HandleTypeDef *hcan, uint32_t fifo)
 {
     CAN_RxHeaderTypeDef hdr;
-    can_bsp_msg_t msg;
+    can_bsp_msg_t batch[CAN_BSP_RX_BATCH];
+    uint8_t bus = (hcan->Instance == CAN2) ? CAN_BSP_BUS2 : CAN_BSP_BUS1;
+    uint8_t n = 0;
+    uint8_t total = 0;
 
-    HAL_CAN_GetRxMessage(hcan, CAN_RX_FIFO0, &hdr, msg.data);
+    while (HAL_CAN_GetRxFifoFillLevel(hcan, fifo) > 0)
+    {
+        if (HAL_CAN_GetRxMessage(hcan, fifo, &hdr, batch[n].data) != HAL_OK)
+            break;
 
-    msg.id  = hdr.StdId;
-    msg.dlc = hdr.DLC;
+        batch[n].id  = hdr.StdId;
+        batch[n].dlc = hdr.DLC;
+        batch[n].hw_timestamp = hdr.Timestamp;
+        batch[n].timestamp = DWT->CYCCNT;
+        total++;
 
+        if (redundancy == CAN_BSP_REDUNDANCY_DUAL && can_bsp_rx_duplicate(bus, &batch[n]))
+        {
+            rx_stats.duplicates++;
+            continue;
+        }
 
+        if (++n == CAN_BSP_RX_BATCH)
+        {
+            can_bsp_rx_deliver(fifo, batch, n);
+            n = 0;
+        }
+    }
 
-    	CAN_BSP_RxCallback(&msg);
-        if (hcan->Instance == CAN2 && hdr.StdId == 0x123){
+    if (n > 0)
+        can_bsp_rx_deliver(fifo, batch, n);
 
+    if (fifo == CAN_RX_FIFO1)
+        rx_stats.fifo1_frames += total;
+    else
+        rx_stats.fifo0_frames += total;
+
+    rx_stats.bus_frames[bus] += total;
+
+    if (total > rx_stats.max_batch)
+        rx_stats.max_batch = total;
+}
+
+void HAL_CAN_RxFifo0MsgPendingCallback(CAN_HandleTypeDef *hcan)
+{
+    can_bsp_rx_drain(hcan, CAN_RX_FIFO0);
+}
+
+void HAL_CAN_RxFifo1MsgPendingCallback(CAN_HandleTypeDef *hcan)
+{
+    can_bsp_rx_drain(hcan, CAN_RX_FIFO1);
+}
+
+void HAL_CAN_ErrorCallback(CAN_HandleTypeDef *hcan)
+{
+    uint32_t err = HAL_CAN_GetError(hcan);
+
+    if (err & HAL_CAN_ERROR_RX_FOV0)
+        rx_stats.fifo0_overruns++;
+    if (err & HAL_CAN_ERROR_RX_FOV1)
+        rx_stats.fifo1_overruns++;
+
+    if (err & (HAL_CAN_ERROR_EWG | HAL_CAN_ERROR_EPV | HAL_CAN_ERROR_BOF))
+        CAN_BSP_ErrorCallback((hcan->Instance == CAN2) ? CAN_BSP_BUS2 : CAN_BSP_BUS1, err);
+
+    HAL_CAN_ResetError(hcan);
+}
+
+__weak void CAN_BSP_ErrorCallback(uint8_t bus, uint32_t error)
+{
+    // vacío por defecto
+}
+
+void CAN_BSP_GetBusStatus(uint8_t bus, can_bsp_bus_status_t *status)
+{
+    uint32_t esr = ((bus == CAN_BSP_BUS2) ? hcan2.Instance : hcan1.Instance)->ESR;
+
+    status->tec     = (esr & CAN_ESR_TEC_Msk) >> CAN_ESR_TEC_Pos;
+    status->rec     = (esr & CAN_ESR_REC_Msk) >> CAN_ESR_REC_Pos;
+    status->lec     = (esr & CAN_ESR_LEC_Msk) >> CAN_ESR_LEC_Pos;
+    status->warning = (esr & CAN_ESR_EWGF) ? 1 : 0;
+    status->passive = (esr & CAN_ESR_EPVF) ? 1 : 0;
+    status->bus_off = (esr & CAN_ESR_BOFF) ? 1 : 0;
+}
+
+can_bsp_status_t CAN_BSP_Restart(uint8_t bus)
+{
+    CAN_HandleTypeDef *hcan = (bus == CAN_BSP_BUS2) ? &hcan2 : &hcan1;
+
+    // Stop/Start pasa por modo init. Entrar en init no borra TEC/REC: al
+    // salir, el bxCAN deja el bus-off tras 128 x 11 bits recesivos
+    if (hcan->State == HAL_CAN_STATE_LISTENING &&
+        HAL_CAN_Stop(hcan) == HAL_OK && HAL_CAN_Start(hcan) == HAL_OK)
+        return CAN_BSP_OK;
+
+    // Con el bus bloqueado Start (o Stop) agota su timeout y deja el handle
+    // en HAL_CAN_STATE_ERROR: HAL ya no acepta Start ni AddTxMessage.
+    // HAL_CAN_Init lo recupera (como en CAN_BSP_SetTiming; no toca filtros
+    // ni interrupciones) y se vuelve a arrancar
+    for (uint8_t attempt = 0; attempt < CAN_BSP_RESTART_RETRIES; attempt++)
+    {
+        if (HAL_CAN_Init(hcan) == HAL_OK && HAL_CAN_Start(hcan) == HAL_OK)
+            return CAN_BSP_OK;
+    }
+
+    return CAN_BSP_ERROR;
+}
+
+can_bsp_status_t CAN_BSP_CalcTiming(uint32_t bitrate, uint16_t sample_point, can_bsp_timing_t *timing)
+{
+    uint32_t pclk = HAL_RCC_GetPCLK1Freq();
+    uint16_t best_err = 0xFFFF;
+
+    if (bitrate == 0 || bitrate > CAN_BSP_MAX_BITRATE || sample_point >= 1000)
+        return CAN_BSP_ERROR;
+
+    if (sample_point == 0)
+        sample_point = CAN_BSP_DEFAULT_SP;
+
+    // Más TQ por bit primero: mejor resolución del punto de muestreo
+    for (uint32_t tq = CAN_BSP_TQ_MAX; tq >= CAN_BSP_TQ_MIN; tq--)
+    {
+        uint32_t prescaler;
+        int32_t bs1, bs2;
+        uint16_t sp, err;
+
+        if (pclk % (bitrate * tq) != 0)
+            continue;
+
+        prescaler = pclk / (bitrate * tq);
+        if (prescaler < 1 || prescaler > 1024)
+            continue;
+
+        // Muestreo al final de BS1: redondear (1 + bs1) a sample_point * tq
+        bs1 = (int32_t)((sample_point * tq + 500) / 1000) - 1;
+        if (bs1 < 1)
+            bs1 = 1;
+        if (bs1 > 16)
+            bs1 = 16;
+        bs2 = (int32_t)tq - 1 - bs1;
+        if (bs2 < 1 || bs2 > 8)
+            continue;
+
+        sp = (uint16_t)(((1 + bs1) * 1000) / tq);
+        err = (sp > sample_point) ? sp - sample_point : sample_point - sp;
+
+        if (err < best_err)
+        {
+            best_err = err;
+            timing->bitrate = bitrate;
+            timing->prescaler = prescaler;
+            timing->bs1 = bs1;
+            timing->bs2 = bs2;
+            timing->sjw = (bs2 < 4) ? bs2 : 4;
+            timing->sample_point = sp;
         }
+    }
+
+    if (best_err > CAN_BSP_SP_TOLERANCE)
+        return CAN_BSP_ERROR;
+
+    return CAN_BSP_OK;
+}
+
+can_bsp_status_t CAN_BSP_SetTiming(uint8_t bus, const can_bsp_timing_t *timing)
+{
+    CAN_HandleTypeDef *hcan = (bus == CAN_BSP_BUS2) ? &hcan2 : &hcan1;
+    uint8_t running = (hcan->State == HAL_CAN_STATE_LISTENING);
 
+    if (timing->prescaler < 1 || timing->prescaler > 1024 ||
+        timing->bs1 < 1 || timing->bs1 > 16 ||
+        timing->bs2 < 1 || timing->bs2 > 8 ||
+        timing->sjw < 1 || timing->sjw > 4)
+        return CAN_BSP_ERROR;
+
+    if (running && HAL_CAN_Stop(hcan) != HAL_OK)
+        return CAN_BSP_ERROR;
+
+    // HAL_CAN_Init con el handle ya inicializado no repite el MSP
+    hcan->Init.Prescaler = timing->prescaler;
+    hcan->Init.TimeSeg1 = (uint32_t)(timing->bs1 - 1) << CAN_BTR_TS1_Pos;
+    hcan->Init.TimeSeg2 = (uint32_t)(timing->bs2 - 1) << CAN_BTR_TS2_Pos;
+    hcan->Init.SyncJumpWidth = (uint32_t)(timing->sjw - 1) << CAN_BTR_SJW_Pos;
+
+    if (HAL_CAN_Init(hcan) != HAL_OK)
+        return CAN_BSP_ERROR;
+
+    if (running && HAL_CAN_Start(hcan) != HAL_OK)
+        return CAN_BSP_ERROR;
+
+    return CAN_BSP_OK;
 }
 
-//void HAL_CAN_RxFifo0MsgPendingCallback(CAN_HandleTypeDef *hcan)
-//{
-//  while (HAL_CAN_GetRxFifoFillLevel(hcan, CAN_RX_FIFO0) > 0)
-//  {
-//    HAL_CAN_GetRxMessage(hcan, CAN_RX_FIFO0, &rxHeader, rxData);
-//
-//    if (hcan->Instance == CAN2 && rxHeader.StdId == 0x123)
-//    {
-//      CAN_TxHeaderTypeDef replyHeader = {
-//        .StdId = 0x321,
-//        .IDE = CAN_ID_STD,
-//        .RTR = CAN_RTR_DATA,
-//        .DLC = 8,
-//    	.TransmitGlobalTime = DISABLE
-//      };
-//
-//            rxLength = rxHeader.DLC;        // Cuántos bytes llegaron
-//            for(uint32_t i=0; i<rxLength; i++)
-//                rxBuffer[i] = rxData[i];    // Guardamos los datos recibidos
-//
-//      uint32_t mb;
-//      uint8_t reply[8] = {'H','i',' ','C','A','N',' ','1'};
-//      HAL_CAN_AddTxMessage(&hcan2, &replyHeader, reply, &mb);
-//    }
-//
-//    if (hcan->Instance == CAN1 && rxHeader.StdId == 0x321)
-//    {
-//        for(uint32_t i=0; i<rxLength; i++)
-//            rxBuffer2[i] = rxData[i];    // Guardamos los datos recibidos
-//    }
-//  }
-//}
+can_bsp_status_t CAN_BSP_SetBitrate(uint8_t bus, uint32_t bitrate, uint16_t sample_point)
+{
+    can_bsp_timing_t timing;
+
+    if (CAN_BSP_CalcTiming(bitrate, sample_point, &timing) != CAN_BSP_OK)
+        return CAN_BSP_ERROR;
+
+    return CAN_BSP_SetTiming(bus, &timing);
+}
+
+void CAN_BSP_GetTiming(uint8_t bus, can_bsp_timing_t *timing)
+{
+    CAN_HandleTypeDef *hcan = (bus == CAN_BSP_BUS2) ? &hcan2 : &hcan1;
+    uint32_t tq;
+
+    timing->prescaler = hcan->Init.Prescaler;
+    timing->bs1 = (hcan->Init.TimeSeg1 >> CAN_BTR_TS1_Pos) + 1;
+    timing->bs2 = (hcan->Init.TimeSeg2 >> CAN_BTR_TS2_Pos) + 1;
+    timing->sjw = (hcan->Init.SyncJumpWidth >> CAN_BTR_SJW_Pos) + 1;
+
+    tq = 1 + timing->bs1 + timing->bs2;
+    timing->bitrate = HAL_RCC_GetPCLK1Freq() / (timing->prescaler * tq);
+    timing->sample_point = ((1 + timing->bs1) * 1000) / tq;
+}
@@ -0,0 +1,60 @@
+/*
+ * can_dispatch.c
+ *
+ *  Despacho de tramas CAN por tabla ordenada y búsqueda binaria.
+ */
+
+#include "can_dispatch.h"
+
+static const can_dispatch_entry_t *dispatch_table;
+static uint16_t                    dispatch_count;
+static uint32_t                    dispatch_unhandled;
+
+void CAN_Dispatch_Init(const can_dispatch_entry_t *table, uint16_t count)
+{
+    for (uint16_t i = 0; i < count; i++)
+    {
+        // La búsqueda binaria necesita IDs estrictamente crecientes
+        if (i > 0 && table[i].id <= table[i - 1].id)
+        {
+            // Error: tabla desordenada o ID repetido
+            while(1);  // Quedarse aquí para debug
+        }
+
+        CAN_BSP_AddFilter(table[i].id, table[i].fifo);
+    }
+
+    dispatch_table = table;
+    dispatch_count = count;
+}
+
+uint8_t CAN_Dispatch(const can_bsp_msg_t *msg)
+{
+    uint16_t lo = 0;
+    uint16_t hi = dispatch_count;
+
+    while (lo < hi)
+    {
+        uint16_t mid = lo + (hi - lo) / 2;
+        const can_dispatch_entry_t *e = &dispatch_table[mid];
+
+        if (e->id == msg->id)
+        {
+            e->handler(msg, e->ctx);
+            return 1;
+        }
+
+        if (e->id < msg->id)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    dispatch_unhandled++;
+    return 0;
+}
+
+uint32_t CAN_Dispatch_GetUnhandled(void)
+{
+    return dispatch_unhandled;
+}
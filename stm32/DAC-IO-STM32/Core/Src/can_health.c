@@ -0,0 +1,287 @@
+/*
+ * can_health.c
+ *
+ *  Vigilancia del estado de error de CAN1/CAN2.
+ *
+ *  Las transiciones se detectan leyendo ESR, tanto desde la ISR SCE (aviso,
+ *  pasivo, bus-off) como desde un temporizador software: la vuelta a error
+ *  activo no genera interrupción. Con AutoBusOff el bxCAN sale solo de
+ *  bus-off; si no lo consigue en CAN_HEALTH_RESTART_MS se reinicia a mano.
+ */
+
+#include "can_health.h"
+#include "can_task.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+
+#define CAN_HEALTH_ACTIVE_BUS   0xFF
+
+static can_health_t  health[2];
+static TickType_t    busoff_since[2];
+static uint8_t       restart_failed[2]; // controlador fuera del bus hasta reiniciar bien
+static uint8_t       bus1_alive;        // CAN1 da señales de vida desde bus1_alive_since
+static TickType_t    bus1_alive_since;
+static TickType_t    bus1_last_alive;
+static TickType_t    bus1_last_probe;
+static uint32_t      bus1_rx_seen;
+static uint32_t      bus1_tx_seen;
+static uint8_t       publish_now[2];
+static TimerHandle_t health_timer;
+
+static void can_health_publish(uint8_t out_bus, uint8_t bus, const can_health_t *h);
+
+static can_health_state_t can_health_state(const can_bsp_bus_status_t *st)
+{
+    if (st->bus_off)
+        return CAN_HEALTH_BUS_OFF;
+    if (st->passive)
+        return CAN_HEALTH_PASSIVE;
+    if (st->warning)
+        return CAN_HEALTH_WARNING;
+    return CAN_HEALTH_ACTIVE;
+}
+
+// Llamar en sección crítica
+static void can_health_update(uint8_t bus, TickType_t now)
+{
+    can_bsp_bus_status_t st;
+    can_health_t *h = &health[bus];
+    can_health_state_t state;
+    uint32_t ms = now * portTICK_PERIOD_MS;
+
+    CAN_BSP_GetBusStatus(bus, &st);
+    h->tec = st.tec;
+    h->rec = st.rec;
+    if (st.lec != 0)
+        h->lec = st.lec;
+
+    state = can_health_state(&st);
+    if (state == h->state)
+        return;
+
+    if (h->state == CAN_HEALTH_BUS_OFF)
+    {
+        h->recoveries++;
+        h->last_recovery_ms = ms;
+    }
+
+    switch (state)
+    {
+    case CAN_HEALTH_WARNING:
+        if (h->state < CAN_HEALTH_WARNING)
+            h->warning_count++;
+        break;
+
+    case CAN_HEALTH_PASSIVE:
+        if (h->state < CAN_HEALTH_PASSIVE)
+        {
+            h->passive_count++;
+            h->last_passive_ms = ms;
+        }
+        break;
+
+    case CAN_HEALTH_BUS_OFF:
+        h->busoff_count++;
+        h->last_busoff_ms = ms;
+        busoff_since[bus] = now;
+        break;
+
+    default:
+        break;
+    }
+
+    h->state = state;
+    h->last_change_ms = ms;
+    publish_now[bus] = 1;
+}
+
+// Llamar en sección crítica, después de can_health_update
+static void can_health_select_bus(TickType_t now)
+{
+    uint8_t active = CAN_BSP_GetActiveBus();
+    uint8_t other = active ^ 1;
+
+    if (CAN_BSP_GetRedundancy() == CAN_BSP_REDUNDANCY_NONE)
+        return;
+
+    // El activo ya no entrega tramas (sin ACK o en corto) y el otro sí puede
+    if (health[active].state >= CAN_HEALTH_PASSIVE && health[other].state <= CAN_HEALTH_WARNING)
+    {
+        health[active].failovers++;
+        publish_now[active] = 1;
+        CAN_BSP_SetActiveBus(other);
+        if (other == CAN_BSP_BUS2)
+            bus1_alive = 0;
+    }
+}
+
+/*
+ * Vuelta a CAN1, desde el temporizador. Señal de vida: alguna trama de
+ * CAN1 con ACK (el sondeo) o recibida desde la última pasada. Con solo
+ * recepción, si la TX de CAN1 sigue rota el TEC no baja de pasivo y no
+ * se vuelve: así no se rebota entre buses.
+ */
+static void can_health_failback(TickType_t now)
+{
+    can_bsp_rx_stats_t rx = CAN_BSP_GetRxStats();
+    can_bsp_tx_stats_t tx1 = CAN_BSP_GetBusTxStats(CAN_BSP_BUS1);
+    uint8_t evidence = rx.bus_frames[CAN_BSP_BUS1] != bus1_rx_seen || tx1.sent != bus1_tx_seen;
+    can_health_state_t state;
+
+    bus1_rx_seen = rx.bus_frames[CAN_BSP_BUS1];
+    bus1_tx_seen = tx1.sent;
+
+    if (CAN_BSP_GetRedundancy() == CAN_BSP_REDUNDANCY_NONE || CAN_BSP_GetActiveBus() != CAN_BSP_BUS2)
+        return;
+
+    // Racha de señales de vida: se corta si pasan dos sondeos sin ninguna
+    if (evidence)
+    {
+        if (!bus1_alive || (now - bus1_last_alive) > pdMS_TO_TICKS(2 * CAN_HEALTH_PROBE_MS))
+        {
+            bus1_alive = 1;
+            bus1_alive_since = now;
+        }
+        bus1_last_alive = now;
+    }
+    else if (bus1_alive && (now - bus1_last_alive) > pdMS_TO_TICKS(2 * CAN_HEALTH_PROBE_MS))
+    {
+        bus1_alive = 0;
+    }
+
+    taskENTER_CRITICAL();
+    state = health[CAN_BSP_BUS1].state;
+    taskEXIT_CRITICAL();
+
+    if (bus1_alive && state <= CAN_HEALTH_WARNING &&
+        (now - bus1_alive_since) >= pdMS_TO_TICKS(CAN_HEALTH_FAILBACK_MS))
+    {
+        bus1_alive = 0;
+        CAN_BSP_SetActiveBus(CAN_BSP_BUS1);
+        return;
+    }
+
+    // Sondeo: un solo mailbox como mucho; sin ACK se queda reintentando
+    // (en error pasivo los errores de ACK ya no suben el TEC)
+    if ((now - bus1_last_probe) >= pdMS_TO_TICKS(CAN_HEALTH_PROBE_MS) && CAN_BSP_TxIdle(CAN_BSP_BUS1))
+    {
+        can_health_t snapshot;
+
+        taskENTER_CRITICAL();
+        snapshot = health[CAN_BSP_BUS1];
+        taskEXIT_CRITICAL();
+
+        bus1_last_probe = now;
+        can_health_publish(CAN_BSP_BUS1, CAN_BSP_BUS1, &snapshot);
+    }
+}
+
+void CAN_BSP_ErrorCallback(uint8_t bus, uint32_t error)
+{
+    UBaseType_t saved = taskENTER_CRITICAL_FROM_ISR();
+    TickType_t now = xTaskGetTickCountFromISR();
+
+    can_health_update(bus, now);
+    can_health_select_bus(now);
+    taskEXIT_CRITICAL_FROM_ISR(saved);
+}
+
+// out_bus = CAN_HEALTH_ACTIVE_BUS: por el bus activo
+static void can_health_publish(uint8_t out_bus, uint8_t bus, const can_health_t *h)
+{
+    can_bsp_tx_stats_t tx = CAN_BSP_GetBusTxStats(bus);
+    uint32_t lat = 0;
+    uint8_t data[8];
+
+    for (uint8_t i = 0; i < 3; i++)
+        if (tx.mb_latency_max_us[i] > lat)
+            lat = tx.mb_latency_max_us[i];
+
+    if (lat > 0xFFFF)
+        lat = 0xFFFF;
+
+    data[0] = bus | (h->state << 4);
+    data[1] = h->tec;
+    data[2] = h->rec;
+    data[3] = h->lec;
+    data[4] = h->busoff_count & 0xFF;
+    data[5] = h->recoveries & 0xFF;
+    data[6] = lat & 0xFF;
+    data[7] = lat >> 8;
+
+    if (out_bus == CAN_HEALTH_ACTIVE_BUS)
+        CAN_BSP_Send(CAN_ID_CAN_HEALTH, data, sizeof(data));
+    else
+        CAN_BSP_SendOnBus(out_bus, CAN_ID_CAN_HEALTH, data, sizeof(data));
+}
+
+static void can_health_timer(TimerHandle_t t)
+{
+    static uint16_t elapsed_ms;
+    TickType_t now = xTaskGetTickCount();
+    uint8_t periodic;
+
+    elapsed_ms += CAN_HEALTH_POLL_MS;
+    periodic = (elapsed_ms >= CAN_HEALTH_PUBLISH_MS);
+    if (periodic)
+        elapsed_ms = 0;
+
+    for (uint8_t bus = CAN_BSP_BUS1; bus <= CAN_BSP_BUS2; bus++)
+    {
+        can_health_t snapshot;
+        uint8_t publish;
+
+        taskENTER_CRITICAL();
+        can_health_update(bus, now);
+        can_health_select_bus(now);
+        snapshot = health[bus];
+        publish = publish_now[bus] || periodic;
+        publish_now[bus] = 0;
+        taskEXIT_CRITICAL();
+
+        // AutoBusOff no ha sacado al controlador del bus-off: reiniciarlo.
+        // Si falla, el controlador queda parado aunque el ESR ya no marque
+        // bus-off: se reintenta cada CAN_HEALTH_RESTART_MS hasta que arranque
+        if ((snapshot.state == CAN_HEALTH_BUS_OFF || restart_failed[bus]) &&
+            (now - busoff_since[bus]) >= pdMS_TO_TICKS(CAN_HEALTH_RESTART_MS))
+        {
+            busoff_since[bus] = now;
+            health[bus].restarts++;
+            restart_failed[bus] = (CAN_BSP_Restart(bus) != CAN_BSP_OK);
+            if (restart_failed[bus])
+            {
+                health[bus].restart_errors++;
+                publish = 1;
+            }
+        }
+
+        if (publish)
+            can_health_publish(CAN_HEALTH_ACTIVE_BUS, bus, &snapshot);
+    }
+
+    can_health_failback(now);
+
+    if (periodic)
+        CAN_BSP_ResetTxLatency();
+}
+
+can_health_t CAN_Health_Get(uint8_t bus)
+{
+    can_health_t copy;
+
+    taskENTER_CRITICAL();
+    copy = health[bus & 1];
+    taskEXIT_CRITICAL();
+
+    return copy;
+}
+
+void CAN_Health_Init(void)
+{
+    health_timer = xTimerCreate("can_health", pdMS_TO_TICKS(CAN_HEALTH_POLL_MS), pdTRUE, NULL,
+                                can_health_timer);
+
+    if (health_timer != NULL)
+        xTimerStart(health_timer, 0);
+}
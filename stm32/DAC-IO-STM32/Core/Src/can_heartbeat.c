@@ -0,0 +1,92 @@
+/*
+ * can_heartbeat.c
+ *
+ *  Latido periódico (temporizador software) y respuesta a pings de la RPi.
+ */
+
+#include "can_heartbeat.h"
+#include "can_task.h"
+#include "motor_task.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+
+static TimerHandle_t hb_timer;
+static uint32_t      hb_period_ms = CAN_HEARTBEAT_DEFAULT_MS;
+static uint8_t       hb_seq;
+static uint16_t      hb_echo;           // 16 bits bajos del último ping
+static TickType_t    hb_ping_tick;
+
+// Se llama desde el temporizador y desde la tarea CANRX
+static void hb_send(void)
+{
+    TickType_t now = xTaskGetTickCount();
+    uint32_t uptime_s = (now * portTICK_PERIOD_MS) / 1000;
+    uint32_t hold_ms;
+    uint8_t data[8];
+
+    taskENTER_CRITICAL();
+    hold_ms = (now - hb_ping_tick) * portTICK_PERIOD_MS;
+    data[0] = hb_seq++;
+    data[4] = hb_echo & 0xFF;
+    data[5] = hb_echo >> 8;
+    taskEXIT_CRITICAL();
+
+    if (hold_ms > 0xFFFF)
+        hold_ms = 0xFFFF;
+
+    data[1] = MotorTask_GetDoorStatus().state;
+    data[2] = uptime_s & 0xFF;
+    data[3] = (uptime_s >> 8) & 0xFF;
+    data[6] = hold_ms & 0xFF;
+    data[7] = hold_ms >> 8;
+    CAN_BSP_Send(CAN_ID_HEARTBEAT, data, sizeof(data));
+}
+
+static void hb_timer_cb(TimerHandle_t t)
+{
+    hb_send();
+}
+
+void CAN_Heartbeat_OnPing(const can_bsp_msg_t *msg, void *ctx)
+{
+    if (msg->dlc < 2)
+        return;
+
+    taskENTER_CRITICAL();
+    hb_echo = msg->data[0] | ((uint16_t)msg->data[1] << 8);
+    hb_ping_tick = xTaskGetTickCount();
+    taskEXIT_CRITICAL();
+
+    hb_send();
+}
+
+uint8_t CAN_Heartbeat_SetPeriod(uint32_t period_ms)
+{
+    if (period_ms != 0 && (period_ms < CAN_HEARTBEAT_MIN_MS || period_ms > CAN_HEARTBEAT_MAX_MS))
+        return 0;
+
+    if (hb_timer == NULL)
+        return 0;
+
+    hb_period_ms = period_ms;
+
+    // xTimerChangePeriod también arranca el temporizador si estaba parado
+    if (period_ms == 0)
+        return xTimerStop(hb_timer, pdMS_TO_TICKS(10)) == pdPASS;
+
+    return xTimerChangePeriod(hb_timer, pdMS_TO_TICKS(period_ms), pdMS_TO_TICKS(10)) == pdPASS;
+}
+
+uint32_t CAN_Heartbeat_GetPeriod(void)
+{
+    return hb_period_ms;
+}
+
+void CAN_Heartbeat_Init(void)
+{
+    hb_timer = xTimerCreate("heartbeat", pdMS_TO_TICKS(hb_period_ms), pdTRUE, NULL, hb_timer_cb);
+
+    if (hb_timer != NULL)
+        xTimerStart(hb_timer, 0);
+}
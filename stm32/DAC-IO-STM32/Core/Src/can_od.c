@@ -0,0 +1,305 @@
+/*
+ * can_od.c
+ *
+ *  Diccionario de objetos sobre CAN (SDO/PDO reducido).
+ *
+ *  Las peticiones se atienden en la tarea CANRX. Las escrituras van a cada
+ *  módulo por su API normal (cola del motor, tarea de pantalla...), así que
+ *  ningún parámetro se toca desde otra tarea. Los PDO los envía un
+ *  temporizador software; los getters no deben bloquear.
+ */
+
+#include "can_od.h"
+#include "can_task.h"
+#include "can_bsp.h"
+#include "motor_task.h"
+#include "fingerprint_task.h"
+#include "display_task.h"
+#include "display_driver.h"
+#include "can_health.h"
+#include "can_heartbeat.h"
+#include "can_bitrate.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+
+typedef struct {
+    uint16_t index;
+    uint32_t min;
+    uint32_t max;
+    uint32_t (*get)(void);
+    uint8_t  (*set)(uint32_t value);    // NULL = solo lectura
+} can_od_entry_t;
+
+typedef struct {
+    uint16_t   index;       // 0 = ranura libre
+    uint8_t    on_change;
+    TickType_t period;      // 0 = solo por cambio
+    TickType_t last_tx;
+    uint32_t   last_value;
+} can_od_sub_t;
+
+static can_od_sub_t  od_subs[CAN_OD_MAX_SUBS];
+static TimerHandle_t od_timer;
+
+/* ---------------------------------------------------------------------- */
+/* Getters / setters                                                      */
+
+static uint32_t od_get_uptime(void)        { return (xTaskGetTickCount() * portTICK_PERIOD_MS) / 1000; }
+static uint32_t od_get_free_heap(void)     { return xPortGetFreeHeapSize(); }
+static uint32_t od_get_tx_overflows(void)  { return CAN_BSP_GetTxStats().overflows; }
+static uint32_t od_get_rx_drops(void)      { return CAN_App_GetStats().rx_queue_drops; }
+static uint32_t od_get_can_tec(void)       { return CAN_Health_Get(CAN_BSP_BUS1).tec; }
+static uint32_t od_get_can_busoffs(void)   { return CAN_Health_Get(CAN_BSP_BUS1).busoff_count; }
+static uint32_t od_get_hb_period(void)     { return CAN_Heartbeat_GetPeriod(); }
+static uint32_t od_get_can_kbps(void)      { return CAN_Bitrate_GetKbps(); }
+static uint32_t od_get_redundancy(void)    { return CAN_BSP_GetRedundancy(); }
+static uint8_t  od_set_redundancy(uint32_t v) { CAN_BSP_SetRedundancy((uint8_t)v); return 1; }
+static uint32_t od_get_active_bus(void)    { return CAN_BSP_GetActiveBus(); }
+static uint32_t od_get_rx_lat_max(void)    { return CAN_App_GetRxLatency(CAN_RX_PATH_NORMAL).to_task_max_us; }
+static uint8_t  od_set_hb_period(uint32_t v) { return CAN_Heartbeat_SetPeriod(v); }
+
+static uint32_t od_get_door_state(void)    { return MotorTask_GetDoorStatus().state; }
+static uint32_t od_get_open_time(void)     { return MotorTask_GetDoorStatus().open_time_ms; }
+static uint32_t od_get_step_ms(void)       { return MotorTask_GetDoorStatus().motor_speed_ms; }
+static uint32_t od_get_operations(void)    { return MotorTask_GetDoorStatus().operations_count; }
+static uint8_t  od_set_open_time(uint32_t v) { return MotorTask_SetOpenTime(v); }
+static uint8_t  od_set_step_ms(uint32_t v)   { return MotorTask_SetSpeed(v); }
+
+static uint32_t od_get_fp_quiet(void)      { return FingerprintTask_GetQuietInterval(); }
+static uint32_t od_get_fp_upload(void)     { return FingerprintTask_GetImageUpload(); }
+static uint32_t od_get_fp_scans(void)      { return FingerprintTask_GetStats().scans; }
+static uint32_t od_get_fp_matches(void)    { return FingerprintTask_GetStats().matches; }
+static uint32_t od_get_fp_rejections(void) { return FingerprintTask_GetStats().rejections; }
+static uint32_t od_get_fp_dropped(void)    { return FingerprintTask_GetStats().events_dropped; }
+static uint32_t od_get_fp_uart_ovf(void)   { return FingerprintTask_GetStats().uart_overflows; }
+static uint32_t od_get_confirm_loop(void)  { return CAN_App_GetStats().confirm_loop_ms; }
+static uint8_t  od_set_fp_quiet(uint32_t v)  { FingerprintTask_SetQuietInterval(v); return 1; }
+static uint8_t  od_set_fp_upload(uint32_t v) { FingerprintTask_SetImageUpload((uint8_t)v); return 1; }
+
+static uint32_t od_get_contrast(void)      { return DisplayTask_GetContrast(); }
+static uint8_t  od_set_contrast(uint32_t v)  { DisplayTask_SetContrast((uint8_t)v); return 1; }
+static uint32_t od_get_update_bytes(void) { return Display_GetUpdateStats().last_bytes; }
+static uint32_t od_get_render_max(void)  { return DisplayTask_GetRenderStats().max_us; }
+
+/* Ordenada por índice */
+static const can_od_entry_t od_table[] = {
+    { OD_SYS_UPTIME_S,         0, 0,      od_get_uptime,        NULL },
+    { OD_SYS_FREE_HEAP,        0, 0,      od_get_free_heap,     NULL },
+    { OD_SYS_CAN_TX_OVERFLOWS, 0, 0,      od_get_tx_overflows,  NULL },
+    { OD_SYS_CAN_RX_DROPS,     0, 0,      od_get_rx_drops,      NULL },
+    { OD_SYS_CAN_TEC,          0, 0,      od_get_can_tec,       NULL },
+    { OD_SYS_CAN_BUSOFFS,      0, 0,      od_get_can_busoffs,   NULL },
+    { OD_SYS_HEARTBEAT_MS,     0, CAN_HEARTBEAT_MAX_MS, od_get_hb_period, od_set_hb_period },
+    { OD_SYS_CAN_BITRATE_KBPS, 0, 0,      od_get_can_kbps,      NULL },
+    { OD_SYS_CAN_REDUNDANCY,   0, CAN_BSP_REDUNDANCY_DUAL, od_get_redundancy, od_set_redundancy },
+    { OD_SYS_CAN_ACTIVE_BUS,   0, 0,      od_get_active_bus,    NULL },
+    { OD_SYS_CAN_RX_LAT_MAX_US, 0, 0,     od_get_rx_lat_max,    NULL },
+    { OD_DOOR_STATE,           0, 0,      od_get_door_state,    NULL },
+    { OD_DOOR_OPEN_TIME_MS,    500, 60000, od_get_open_time,    od_set_open_time },
+    { OD_MOTOR_STEP_MS,        1, 20,     od_get_step_ms,       od_set_step_ms },
+    { OD_DOOR_OPERATIONS,      0, 0,      od_get_operations,    NULL },
+    { OD_FP_QUIET_MS,          0, 60000,  od_get_fp_quiet,      od_set_fp_quiet },
+    { OD_FP_UPLOAD_ON_REJECT,  0, 1,      od_get_fp_upload,     od_set_fp_upload },
+    { OD_FP_SCANS,             0, 0,      od_get_fp_scans,      NULL },
+    { OD_FP_MATCHES,           0, 0,      od_get_fp_matches,    NULL },
+    { OD_FP_REJECTIONS,        0, 0,      od_get_fp_rejections, NULL },
+    { OD_FP_CONFIRM_LOOP_MS,   0, 0,      od_get_confirm_loop,  NULL },
+    { OD_FP_EVENTS_DROPPED,    0, 0,      od_get_fp_dropped,    NULL },
+    { OD_FP_UART_OVERFLOWS,    0, 0,      od_get_fp_uart_ovf,   NULL },
+    { OD_DISPLAY_CONTRAST,     0, 255,    od_get_contrast,      od_set_contrast },
+    { OD_DISPLAY_UPDATE_BYTES, 0, 0,      od_get_update_bytes,  NULL },
+    { OD_DISPLAY_RENDER_MAX_US, 0, 0,     od_get_render_max,    NULL },
+};
+
+#define OD_TABLE_LEN  (sizeof(od_table) / sizeof(od_table[0]))
+
+static const can_od_entry_t *od_find(uint16_t index)
+{
+    uint16_t lo = 0;
+    uint16_t hi = OD_TABLE_LEN;
+
+    while (lo < hi)
+    {
+        uint16_t mid = lo + (hi - lo) / 2;
+
+        if (od_table[mid].index == index)
+            return &od_table[mid];
+
+        if (od_table[mid].index < index)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return NULL;
+}
+
+/* ---------------------------------------------------------------------- */
+
+static void od_put32(uint8_t *p, uint32_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = (v >> 24) & 0xFF;
+}
+
+static void od_respond(uint8_t cmd, uint16_t index, uint8_t status, uint32_t value)
+{
+    uint8_t tx[8];
+
+    tx[0] = cmd;
+    tx[1] = index & 0xFF;
+    tx[2] = index >> 8;
+    tx[3] = status;
+    od_put32(&tx[4], value);
+    CAN_BSP_Send(CAN_ID_OD_RESPONSE, tx, sizeof(tx));
+}
+
+static void od_send_pdo(uint8_t slot, uint16_t index, uint32_t value)
+{
+    uint8_t tx[6];
+
+    tx[0] = index & 0xFF;
+    tx[1] = index >> 8;
+    od_put32(&tx[2], value);
+    CAN_BSP_Send(CAN_ID_OD_PDO_BASE + slot, tx, sizeof(tx));
+}
+
+static uint8_t od_subscribe(uint16_t index, uint8_t flags, uint32_t period_ms, uint8_t *slot)
+{
+    uint8_t free_slot = CAN_OD_MAX_SUBS;
+
+    // Misma variable otra vez: se actualiza la suscripción existente
+    for (uint8_t i = 0; i < CAN_OD_MAX_SUBS; i++)
+    {
+        if (od_subs[i].index == index)
+        {
+            free_slot = i;
+            break;
+        }
+        if (od_subs[i].index == 0 && free_slot == CAN_OD_MAX_SUBS)
+            free_slot = i;
+    }
+
+    if (free_slot == CAN_OD_MAX_SUBS)
+        return CAN_OD_ERR_NO_SLOT;
+
+    if (period_ms == 0 && !(flags & CAN_OD_SUB_ON_CHANGE))
+        return CAN_OD_ERR_RANGE;
+
+    // El temporizador lee las ranuras: actualizar de forma atómica
+    taskENTER_CRITICAL();
+    od_subs[free_slot].index      = index;
+    od_subs[free_slot].on_change  = flags & CAN_OD_SUB_ON_CHANGE;
+    od_subs[free_slot].period     = pdMS_TO_TICKS(period_ms);
+    od_subs[free_slot].last_tx    = 0;
+    od_subs[free_slot].last_value = 0xFFFFFFFF;
+    taskEXIT_CRITICAL();
+
+    *slot = free_slot;
+    return CAN_OD_OK;
+}
+
+static void od_unsubscribe(uint16_t index)
+{
+    taskENTER_CRITICAL();
+    for (uint8_t i = 0; i < CAN_OD_MAX_SUBS; i++)
+        if (od_subs[i].index == index)
+            od_subs[i].index = 0;
+    taskEXIT_CRITICAL();
+}
+
+void CAN_OD_OnRequest(const can_bsp_msg_t *msg, void *ctx)
+{
+    const can_od_entry_t *e;
+    uint8_t  cmd;
+    uint16_t index;
+    uint32_t value;
+    uint8_t  slot;
+
+    if (msg->dlc < 3)
+        return;
+
+    cmd   = msg->data[0];
+    index = msg->data[1] | ((uint16_t)msg->data[2] << 8);
+    value = (msg->dlc >= 8) ? (msg->data[4] | ((uint32_t)msg->data[5] << 8) |
+                               ((uint32_t)msg->data[6] << 16) | ((uint32_t)msg->data[7] << 24)) : 0;
+
+    e = od_find(index);
+    if (e == NULL)
+    {
+        od_respond(cmd, index, CAN_OD_ERR_NO_OBJECT, 0);
+        return;
+    }
+
+    switch (cmd)
+    {
+    case CAN_OD_CMD_READ:
+        od_respond(cmd, index, CAN_OD_OK, e->get());
+        break;
+
+    case CAN_OD_CMD_WRITE:
+        if (e->set == NULL)
+            od_respond(cmd, index, CAN_OD_ERR_READ_ONLY, 0);
+        else if (value < e->min || value > e->max)
+            od_respond(cmd, index, CAN_OD_ERR_RANGE, value);
+        else if (!e->set(value))
+            od_respond(cmd, index, CAN_OD_ERR_FAILED, value);
+        else
+            od_respond(cmd, index, CAN_OD_OK, value);
+        break;
+
+    case CAN_OD_CMD_SUBSCRIBE:
+    {
+        uint8_t st = od_subscribe(index, (msg->dlc >= 4) ? msg->data[3] : 0, value, &slot);
+        od_respond(cmd, index, st, (st == CAN_OD_OK) ? slot : 0);
+        break;
+    }
+
+    case CAN_OD_CMD_UNSUBSCRIBE:
+        od_unsubscribe(index);
+        od_respond(cmd, index, CAN_OD_OK, 0);
+        break;
+
+    default:
+        od_respond(cmd, index, CAN_OD_ERR_BAD_CMD, 0);
+        break;
+    }
+}
+
+/* ---------------------------------------------------------------------- */
+
+static void od_pdo_timer(TimerHandle_t t)
+{
+    TickType_t now = xTaskGetTickCount();
+
+    for (uint8_t i = 0; i < CAN_OD_MAX_SUBS; i++)
+    {
+        can_od_sub_t sub = od_subs[i];
+        const can_od_entry_t *e;
+        uint32_t value;
+
+        if (sub.index == 0 || (e = od_find(sub.index)) == NULL)
+            continue;
+
+        value = e->get();
+
+        if ((sub.on_change && value != sub.last_value) ||
+            (sub.period != 0 && (now - sub.last_tx) >= sub.period))
+        {
+            od_send_pdo(i, sub.index, value);
+            od_subs[i].last_tx = now;
+            od_subs[i].last_value = value;
+        }
+    }
+}
+
+void CAN_OD_Init(void)
+{
+    od_timer = xTimerCreate("od_pdo", pdMS_TO_TICKS(CAN_OD_PDO_TICK_MS), pdTRUE, NULL, od_pdo_timer);
+
+    if (od_timer != NULL)
+        xTimerStart(od_timer, 0);
+}
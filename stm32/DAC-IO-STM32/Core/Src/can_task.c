@@ -8,6 +8,13 @@
 
 #include "can_task.h"
 #include "can_bsp.h"
+#include "can_tp.h"
+#include "can_dispatch.h"
+#include "can_od.h"
+#include "can_health.h"
+#include "can_heartbeat.h"
+#include "can_bitrate.h"
+#include "fw_update.h"
 #include "fingerprint_task.h"
 #include "motor_task.h"
 
@@ -16,6 +23,134 @@ Motor_Message_t motor_msg;
 
 // Declaración de la variable global de la cola
 static QueueHandle_t can_rx_queue = NULL;
+static QueueHandle_t can_urgent_queue = NULL;
+static can_app_stats_t can_stats;
+static can_rx_latency_t can_rx_latency[2];
+static TickType_t fp_event_tick;    // envío del último MATCH, 0 = sin pendiente
+
+/*
+ * Entrega fiable de eventos de acceso (CAN_ID_FP_EVENT):
+ *   [seq, n, evento 0 .. evento n-1]   cada evento 16 bits big-endian,
+ *                                      bit 15 = match, bits 0-14 = ID
+ * La primera trama desde el arranque lleva CAN_EVT_FLAG_START en n: seq
+ * vuelve a 0 tras cada reset y la RPi debe empezar la secuencia de nuevo.
+ * La RPi confirma con CAN_ID_FP_EVENT_ACK = [último seq recibido en orden].
+ * Hasta CAN_EVT_WINDOW tramas sin confirmar; si no llega el ACK a tiempo se
+ * reenvían todas desde la más antigua (go-back-N). Con la ventana llena no
+ * se leen más eventos: la cola de fingerprint se llena y su tarea espera
+ * hasta FP_EVENT_SEND_MS antes de descartar el evento.
+ */
+typedef struct {
+    uint8_t data[8];
+    uint8_t len;
+} can_evt_frame_t;
+
+static TaskHandle_t    can_task_handle;
+static can_evt_frame_t evt_window[CAN_EVT_WINDOW];
+static uint8_t         evt_base;        // seq de la trama más antigua sin ACK
+static uint8_t         evt_next;        // seq de la siguiente trama
+static uint8_t         evt_started;     // ya se envió la primera trama
+static volatile uint8_t evt_ack;
+static volatile uint8_t evt_ack_pending;
+static TickType_t      evt_deadline;
+
+static void can_evt_send_enroll(const fingerprint_event_t *evt)
+{
+    // [paso, motivo de fallo, ID alto, ID bajo]
+    txData[0] = evt->step;
+    txData[1] = evt->error;
+    txData[2] = (evt->id >> 8) & 0xFF;
+    txData[3] = evt->id & 0xFF;
+    CAN_BSP_Send(CAN_ID_FP_ENROLL, txData, 4);
+}
+
+static void can_evt_process_ack(void)
+{
+    uint8_t ack;
+    uint8_t outstanding = evt_next - evt_base;
+
+    if (!evt_ack_pending)
+        return;
+
+    taskENTER_CRITICAL();
+    ack = evt_ack;
+    evt_ack_pending = 0;
+    taskEXIT_CRITICAL();
+
+    // ACK acumulativo: confirma todas las tramas hasta ack inclusive
+    uint8_t acked = (uint8_t)(ack - evt_base) + 1;
+    if (acked <= outstanding)
+    {
+        evt_base += acked;
+        evt_deadline = xTaskGetTickCount() + pdMS_TO_TICKS(CAN_EVT_RETX_MS);
+    }
+}
+
+static void can_evt_retransmit(void)
+{
+    for (uint8_t seq = evt_base; seq != evt_next; seq++)
+    {
+        can_evt_frame_t *f = &evt_window[seq % CAN_EVT_WINDOW];
+        CAN_BSP_SendCritical(CAN_ID_FP_EVENT, f->data, f->len);
+        can_stats.evt_retransmits++;
+    }
+
+    evt_deadline = xTaskGetTickCount() + pdMS_TO_TICKS(CAN_EVT_RETX_MS);
+}
+
+static void can_evt_send_auth(const fingerprint_event_t *first)
+{
+    can_evt_frame_t *f = &evt_window[evt_next % CAN_EVT_WINDOW];
+    fingerprint_event_t evt = *first;
+    uint8_t n = 0;
+
+    f->data[0] = evt_next;
+
+    for (;;)
+    {
+        uint16_t e = (evt.status == AS608_MATCH) ? (0x8000 | (evt.id & 0x7FFF)) : 0;
+
+        f->data[2 + n * 2] = e >> 8;
+        f->data[3 + n * 2] = e & 0xFF;
+        n++;
+
+        // Inicio del bucle evento -> confirmación de la RPi
+        if (evt.status == AS608_MATCH)
+            fp_event_tick = xTaskGetTickCount();
+
+        // Con cola acumulada, empaquetar los siguientes eventos en la misma trama
+        if (n == CAN_EVT_PER_FRAME ||
+            xQueueReceive(FingerprintTask_GetQueue(), &evt, 0) != pdTRUE)
+            break;
+
+        if (evt.kind == FP_EVT_ENROLL)
+        {
+            can_evt_send_enroll(&evt);
+            break;
+        }
+    }
+
+    f->data[1] = n;
+    f->len = 2 + n * 2;
+
+    // Se guarda con la trama: también va en sus retransmisiones
+    if (!evt_started)
+    {
+        f->data[1] |= CAN_EVT_FLAG_START;
+        evt_started = 1;
+    }
+
+    if (evt_next == evt_base)
+        evt_deadline = xTaskGetTickCount() + pdMS_TO_TICKS(CAN_EVT_RETX_MS);
+    evt_next++;
+    can_stats.evt_frames++;
+
+    // Si la cola TX está llena, la retransmisión se encarga
+    CAN_BSP_SendCritical(CAN_ID_FP_EVENT, f->data, f->len);
+
+    // Debug: indicador visual de envío CAN
+    HAL_GPIO_TogglePin(GPIOD, GPIO_PIN_12);  // LED naranja
+}
 
 static void CANTask(void *arg)
 {
@@ -23,21 +158,171 @@ static void CANTask(void *arg)
 
     for (;;)
     {
-        if (xQueueReceive(FingerprintTask_GetQueue(), &evt, portMAX_DELAY))
+        uint8_t outstanding;
+        TickType_t wait = portMAX_DELAY;
+
+        can_evt_process_ack();
+        outstanding = evt_next - evt_base;
+
+        if (outstanding > 0)
         {
-            txData[0] = (evt.status == AS608_MATCH) ? 1 : 0;
-            txData[1] = (evt.status == AS608_MATCH) ? (evt.id >> 8) & 0xFF : 0;
-            txData[2] = (evt.status == AS608_MATCH) ? evt.id & 0xFF : 0;
-            CAN_BSP_Send(0x123, txData, 3);
+            TickType_t now = xTaskGetTickCount();
+
+            if ((int32_t)(evt_deadline - now) <= 0)
+            {
+                can_evt_retransmit();
+                continue;
+            }
+            wait = evt_deadline - now;
+        }
 
-            // Debug: indicador visual de envío CAN
-            HAL_GPIO_TogglePin(GPIOD, GPIO_PIN_12);  // LED naranja
+        if (outstanding >= CAN_EVT_WINDOW)
+        {
+            // Ventana llena: esperar un ACK (o el timeout de retransmisión)
+            ulTaskNotifyTake(pdTRUE, wait);
+            continue;
+        }
 
-            vTaskDelay(pdMS_TO_TICKS(100));
+        if (xQueueReceive(FingerprintTask_GetQueue(), &evt, wait))
+        {
+            if (evt.kind == FP_EVT_ENROLL)
+                can_evt_send_enroll(&evt);
+            else
+                can_evt_send_auth(&evt);
         }
     }
 }
 
+/* ---------------------------------------------------------------------- */
+/* Handlers de la tabla de despacho                                       */
+
+// Confirmación de la RPi: abrir puerta
+static void can_on_fp_confirm(const can_bsp_msg_t *msg, void *ctx)
+{
+    QueueHandle_t fp_confirm_queue = FingerprintTask_GetConfirmQueue();
+
+    if (fp_event_tick != 0)
+    {
+        // Separar la espera en el nodo (cola + despacho) del resto (bus + RPi)
+        uint32_t local_us = CAN_BSP_CyclesToUs(CAN_BSP_Now() - msg->timestamp);
+        uint32_t loop_ms = (xTaskGetTickCount() - fp_event_tick) * portTICK_PERIOD_MS;
+
+        can_stats.confirm_local_us = local_us;
+        can_stats.confirm_loop_ms = (loop_ms > local_us / 1000) ? loop_ms - local_us / 1000 : 0;
+        if (can_stats.confirm_loop_ms > can_stats.confirm_loop_max_ms)
+            can_stats.confirm_loop_max_ms = can_stats.confirm_loop_ms;
+        fp_event_tick = 0;
+    }
+
+    if (fp_confirm_queue != NULL)
+    {
+        uint8_t confirm = 1;
+        xQueueSend(fp_confirm_queue, &confirm, 0);
+    }
+}
+
+static void can_on_fp_command(const can_bsp_msg_t *msg, void *ctx)
+{
+    if (msg->dlc < 1)
+        return;
+
+    if (msg->data[0] == CAN_FP_CMD_ENROLL_START)
+        Fingerprint_RequestEnroll();
+    else if (msg->data[0] == CAN_FP_CMD_ENROLL_CANCEL)
+        Fingerprint_CancelEnroll();
+    else if (msg->data[0] == CAN_FP_CMD_UPLOAD_IMAGE)
+        Fingerprint_RequestImageUpload();
+}
+
+static void can_on_emergency_stop(const can_bsp_msg_t *msg, void *ctx)
+{
+    MotorTask_EmergencyStop();
+}
+
+// Solo cierre: abrir pasa siempre por huella + CAN_ID_FP_CONFIRM
+static void can_on_door_command(const can_bsp_msg_t *msg, void *ctx)
+{
+    if (msg->dlc < 1)
+        return;
+
+    if (msg->data[0] == CAN_DOOR_CMD_CLOSE)
+        MotorTask_CloseDoor();
+}
+
+static void can_on_fp_event_ack(const can_bsp_msg_t *msg, void *ctx)
+{
+    if (msg->dlc < 1)
+        return;
+
+    taskENTER_CRITICAL();
+    evt_ack = msg->data[0];
+    evt_ack_pending = 1;
+    taskEXIT_CRITICAL();
+
+    xTaskNotifyGive(can_task_handle);
+}
+
+// Datos segmentados y flow control de los canales ISO-TP
+static void can_on_tp(const can_bsp_msg_t *msg, void *ctx)
+{
+    CAN_TP_OnFrame(msg);
+}
+
+__weak void CAN_App_OnRemoteCommand(const can_bsp_msg_t *msg)
+{
+    // comando remoto: vacío por defecto (ver debug_task.c)
+}
+
+static void can_on_remote_command(const can_bsp_msg_t *msg, void *ctx)
+{
+    CAN_App_OnRemoteCommand(msg);
+}
+
+/*
+ * Tabla de recepción, ORDENADA por ID (se comprueba en CAN_Dispatch_Init).
+ * Cada entrada registra además su filtro de aceptación en el FIFO indicado.
+ */
+static const can_dispatch_entry_t can_rx_table[] = {
+    { CAN_ID_EMERGENCY_STOP, CAN_BSP_FIFO1, can_on_emergency_stop, NULL },
+    { CAN_ID_DOOR_COMMAND,   CAN_BSP_FIFO1, can_on_door_command,   NULL },
+    { CAN_ID_FP_CONFIRM,     CAN_BSP_FIFO0, can_on_fp_confirm,     NULL },
+    { CAN_ID_FP_COMMAND,     CAN_BSP_FIFO0, can_on_fp_command,     NULL },
+    { CAN_ID_FP_EVENT_ACK,   CAN_BSP_FIFO0, can_on_fp_event_ack,   NULL },
+    { CAN_ID_REMOTE_COMMAND, CAN_BSP_FIFO0, can_on_remote_command, NULL },
+    { CAN_ID_OD_REQUEST,     CAN_BSP_FIFO0, CAN_OD_OnRequest,      NULL },
+    { CAN_ID_TP_IMAGE_FC,    CAN_BSP_FIFO0, can_on_tp,             NULL },
+    { CAN_ID_TP_FW,          CAN_BSP_FIFO0, can_on_tp,             NULL },
+    { CAN_ID_FW_CONTROL,     CAN_BSP_FIFO0, FW_Update_OnControl,   NULL },
+    { CAN_ID_HB_PING,        CAN_BSP_FIFO0, CAN_Heartbeat_OnPing,  NULL },
+    { CAN_ID_BITRATE_REQUEST, CAN_BSP_FIFO0, CAN_Bitrate_OnRequest, NULL },
+};
+
+static inline void can_latency_update(uint32_t *last, uint32_t *max, uint32_t us)
+{
+    *last = us;
+    if (us > *max)
+        *max = us;
+}
+
+// Despacha una trama recibida y anota cuánto tardó en llegar y en atenderse
+static void can_dispatch_timed(const can_bsp_msg_t *msg, uint8_t path)
+{
+    can_rx_latency_t *lat = &can_rx_latency[path];
+    uint32_t t_task = CAN_BSP_Now();
+    uint32_t t_done;
+
+    CAN_Dispatch(msg);
+    t_done = CAN_BSP_Now();
+
+    taskENTER_CRITICAL();
+    lat->frames++;
+    can_latency_update(&lat->to_task_us, &lat->to_task_max_us,
+                       CAN_BSP_CyclesToUs(t_task - msg->timestamp));
+    can_latency_update(&lat->handler_us, &lat->handler_max_us,
+                       CAN_BSP_CyclesToUs(t_done - t_task));
+    taskEXIT_CRITICAL();
+}
+
 static void CAN_RxTask(void *arg)
 {
     can_bsp_msg_t msg;
@@ -53,52 +338,120 @@ static void CAN_RxTask(void *arg)
         HAL_GPIO_TogglePin(GPIOD, GPIO_PIN_15);  // LED verde
 
         if (xQueueReceive(can_rx_queue, &msg, portMAX_DELAY))
-        {
+            can_dispatch_timed(&msg, CAN_RX_PATH_NORMAL);
+    }
+}
 
+/*
+ * Tramas urgentes (FIFO1). Prioridad por encima del resto de tareas CAN para
+ * que un paro de emergencia no espere detrás de telemetría o ISO-TP.
+ */
+static void CAN_UrgentTask(void *arg)
+{
+    can_bsp_msg_t msg;
 
-            // Verificar si el mensaje es de confirmación desde la RPi
-            if (msg.id == 0x124)
-            {
-                // Enviar confirmación a la tarea de fingerprint
-                QueueHandle_t fp_confirm_queue = FingerprintTask_GetConfirmQueue();
-                if (fp_confirm_queue != NULL)
-                {
-                    uint8_t confirm = 1;
-                    xQueueSend(fp_confirm_queue, &confirm, 0);
-                }
-            }
-        }
+    for (;;)
+    {
+        if (xQueueReceive(can_urgent_queue, &msg, portMAX_DELAY))
+            can_dispatch_timed(&msg, CAN_RX_PATH_URGENT);
     }
 }
 
 void CANTask_Init(void)
 {
 
-    can_rx_queue = xQueueCreate(8, sizeof(can_bsp_msg_t));
+    can_rx_queue = xQueueCreate(CAN_RX_QUEUE_LEN, sizeof(can_bsp_msg_t));
+    can_urgent_queue = xQueueCreate(CAN_URGENT_QUEUE_LEN, sizeof(can_bsp_msg_t));
 
 
-    if (can_rx_queue == NULL)
+    if (can_rx_queue == NULL || can_urgent_queue == NULL)
     {
         // Error: no se pudo crear la cola
 
         while(1);  // Quedarse aquí para debug
     }
 
-    xTaskCreate(CANTask, "CAN", 256, NULL, tskIDLE_PRIORITY + 2, NULL);
+    // IDs que se atienden (el resto se filtra en hardware)
+    CAN_Dispatch_Init(can_rx_table, sizeof(can_rx_table) / sizeof(can_rx_table[0]));
+
+    // Diccionario de objetos: temporizador de PDO
+    CAN_OD_Init();
+
+    // Vigilancia de errores y bus-off
+    CAN_Health_Init();
+
+    // Latido periódico y respuesta a pings
+    CAN_Heartbeat_Init();
+    CAN_Bitrate_Init();
+
+    // Actualización de firmware: canal ISO-TP y tarea de programación
+    FW_Update_Init();
+
+    xTaskCreate(CANTask, "CAN", 256, NULL, tskIDLE_PRIORITY + 2, &can_task_handle);
     xTaskCreate(CAN_RxTask, "CANRX", 256, NULL, tskIDLE_PRIORITY + 1, NULL);
+    xTaskCreate(CAN_UrgentTask, "CANURG", 128, NULL, tskIDLE_PRIORITY + 3, NULL);
 }
 
-void CAN_BSP_RxCallback(const can_bsp_msg_t *msg)
+// Encola el lote entero y cede la CPU una sola vez al final
+static void can_enqueue_batch(QueueHandle_t q, const can_bsp_msg_t *msgs, uint8_t count,
+                              uint32_t *drops, can_rx_latency_t *lat)
 {
     BaseType_t hpw = pdFALSE;
 
-    if (can_rx_queue != NULL)
+    if (q == NULL)
+        return;
+
+    for (uint8_t i = 0; i < count; i++)
     {
-        xQueueSendFromISR(can_rx_queue, msg, &hpw);
+        if (xQueueSendFromISR(q, &msgs[i], &hpw) != pdTRUE)
+            (*drops)++;
+        else
+            can_latency_update(&lat->to_queue_us, &lat->to_queue_max_us,
+                               CAN_BSP_CyclesToUs(CAN_BSP_Now() - msgs[i].timestamp));
+    }
+
+    // Usar la macro correcta
+    portYIELD_FROM_ISR(hpw);
+}
 
-        // Usar la macro correcta
-        portYIELD_FROM_ISR(hpw);
+void CAN_BSP_RxCallback(const can_bsp_msg_t *msgs, uint8_t count)
+{
+    can_enqueue_batch(can_rx_queue, msgs, count, &can_stats.rx_queue_drops,
+                      &can_rx_latency[CAN_RX_PATH_NORMAL]);
+}
+
+void CAN_BSP_RxUrgentCallback(const can_bsp_msg_t *msgs, uint8_t count)
+{
+    can_enqueue_batch(can_urgent_queue, msgs, count, &can_stats.urgent_queue_drops,
+                      &can_rx_latency[CAN_RX_PATH_URGENT]);
+}
+
+can_app_stats_t CAN_App_GetStats(void)
+{
+    return can_stats;
+}
+
+can_rx_latency_t CAN_App_GetRxLatency(uint8_t path)
+{
+    can_rx_latency_t copy;
+
+    taskENTER_CRITICAL();
+    copy = can_rx_latency[path & 1];
+    taskEXIT_CRITICAL();
+
+    return copy;
+}
+
+void CAN_App_ResetRxLatency(void)
+{
+    taskENTER_CRITICAL();
+    for (uint8_t i = 0; i < 2; i++)
+    {
+        can_rx_latency[i].to_queue_max_us = 0;
+        can_rx_latency[i].to_task_max_us = 0;
+        can_rx_latency[i].handler_max_us = 0;
     }
+    taskEXIT_CRITICAL();
 }
 
 QueueHandle_t CAN_App_GetRxQueue(void)
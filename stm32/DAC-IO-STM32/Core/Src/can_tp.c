@@ -0,0 +1,597 @@
+/*
+ * can_tp.c
+ *
+ *  Transporte segmentado estilo ISO 15765-2 sobre CAN_BSP_Send.
+ *
+ *  El reensamblado se hace en la tarea de recepción CAN (CAN_TP_OnFrame).
+ *  Los FC que llegan para un envío en curso se pasan a la tarea emisora
+ *  con un semáforo por canal.
+ */
+
+#include "can_tp.h"
+#include "can_bsp.h"
+#include "task.h"
+#include <string.h>
+
+struct can_tp_channel {
+    uint32_t          rx_id;
+    uint32_t          tx_id;
+    can_tp_rx_cb_t    on_rx;
+    void             *ctx;
+    uint8_t           bs;           // BS que anunciamos
+    uint8_t           stmin;        // STmin que anunciamos
+
+    /* Sesión de recepción */
+    uint8_t          *rx_buf;
+    uint32_t          rx_total;
+    uint32_t          rx_got;
+    uint8_t           rx_sn;
+    uint8_t           rx_block;
+    TickType_t        rx_tick;      // última trama recibida (N_Cr)
+    TickType_t        rx_start;
+
+    /* FC para el emisor local */
+    SemaphoreHandle_t fc_sem;
+    volatile uint8_t  tx_busy;
+    volatile uint8_t  fc_fs;
+    volatile uint8_t  fc_bs;
+    volatile uint8_t  fc_stmin;
+};
+
+static can_tp_channel_t channels[CAN_TP_MAX_CHANNELS];
+static uint8_t          num_channels;
+
+static uint8_t pool[CAN_TP_POOL_BLOCKS][CAN_TP_BLOCK_SIZE];
+static uint8_t pool_used[CAN_TP_POOL_BLOCKS];
+
+static can_tp_stats_t stats;
+
+/* ---------------------------------------------------------------------- */
+
+static uint32_t can_tp_rate(uint32_t bytes, TickType_t start)
+{
+    uint32_t ms = (xTaskGetTickCount() - start) * portTICK_PERIOD_MS;
+
+    if (ms == 0)
+        ms = 1;
+
+    return (bytes * 1000UL) / ms;
+}
+
+// STmin: 0x00-0x7F en ms, 0xF1-0xF9 en centenas de µs (redondeado a 1 tick)
+static TickType_t can_tp_stmin_ticks(uint8_t stmin)
+{
+    if (stmin <= 0x7F)
+        return pdMS_TO_TICKS(stmin);
+
+    if (stmin >= 0xF1 && stmin <= 0xF9)
+        return 1;
+
+    // Valores reservados: usar el máximo
+    return pdMS_TO_TICKS(0x7F);
+}
+
+static can_tp_channel_t *can_tp_find_rx(uint32_t rx_id)
+{
+    for (uint8_t i = 0; i < num_channels; i++)
+        if (channels[i].rx_id == rx_id)
+            return &channels[i];
+
+    return NULL;
+}
+
+static can_tp_channel_t *can_tp_find_tx(uint32_t tx_id)
+{
+    for (uint8_t i = 0; i < num_channels; i++)
+        if (channels[i].tx_id == tx_id)
+            return &channels[i];
+
+    return NULL;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Pool de bloques                                                        */
+
+static void can_tp_rx_drop(can_tp_channel_t *ch)
+{
+    if (ch->rx_buf != NULL)
+    {
+        CAN_TP_Release(ch->rx_buf);
+        ch->rx_buf = NULL;
+    }
+}
+
+static uint8_t *can_tp_alloc(void)
+{
+    uint8_t *block = NULL;
+
+    for (uint8_t pass = 0; pass < 2 && block == NULL; pass++)
+    {
+        taskENTER_CRITICAL();
+        for (uint8_t i = 0; i < CAN_TP_POOL_BLOCKS; i++)
+        {
+            if (!pool_used[i])
+            {
+                pool_used[i] = 1;
+                block = pool[i];
+                break;
+            }
+        }
+        taskEXIT_CRITICAL();
+
+        if (block != NULL || pass > 0)
+            break;
+
+        // Pool lleno: recuperar sesiones abandonadas por el emisor
+        TickType_t now = xTaskGetTickCount();
+        for (uint8_t i = 0; i < num_channels; i++)
+        {
+            if (channels[i].rx_buf != NULL &&
+                (now - channels[i].rx_tick) >= pdMS_TO_TICKS(CAN_TP_CF_TIMEOUT_MS))
+            {
+                can_tp_rx_drop(&channels[i]);
+                stats.rx_timeouts++;
+            }
+        }
+    }
+
+    return block;
+}
+
+void CAN_TP_Release(uint8_t *block)
+{
+    uintptr_t base = (uintptr_t)&pool[0][0];
+    uintptr_t addr = (uintptr_t)block;
+    uint32_t i;
+
+    // Comprobar el rango como enteros antes de calcular el índice: restar
+    // un puntero que no es del pool es comportamiento indefinido
+    if (addr < base || addr >= base + sizeof(pool) || (addr - base) % CAN_TP_BLOCK_SIZE != 0)
+        return;
+
+    i = (addr - base) / CAN_TP_BLOCK_SIZE;
+
+    taskENTER_CRITICAL();
+    pool_used[i] = 0;
+    taskEXIT_CRITICAL();
+}
+
+/* ---------------------------------------------------------------------- */
+
+static can_tp_status_t can_tp_send_frame(uint32_t id, const uint8_t *data, uint8_t len)
+{
+    TickType_t start = xTaskGetTickCount();
+
+    // Mailboxes llenos: ceder la CPU y reintentar
+    while (CAN_BSP_Send(id, data, len) != CAN_BSP_OK)
+    {
+        if ((xTaskGetTickCount() - start) >= pdMS_TO_TICKS(CAN_TP_TX_TIMEOUT_MS))
+            return CAN_TP_TIMEOUT;
+
+        vTaskDelay(1);
+    }
+
+    return CAN_TP_OK;
+}
+
+static void can_tp_send_fc(can_tp_channel_t *ch, uint8_t fs)
+{
+    uint8_t fc[3] = { CAN_TP_PCI_FC | fs, ch->bs, ch->stmin };
+
+    can_tp_send_frame(ch->tx_id, fc, sizeof(fc));
+}
+
+can_tp_status_t CAN_TP_Bind(uint32_t rx_id, uint32_t tx_id,
+                            can_tp_rx_cb_t on_rx, void *ctx)
+{
+    can_tp_channel_t *ch;
+
+    if (num_channels >= CAN_TP_MAX_CHANNELS || can_tp_find_rx(rx_id) != NULL)
+        return CAN_TP_ERROR;
+
+    ch = &channels[num_channels];
+    memset(ch, 0, sizeof(*ch));
+    ch->rx_id  = rx_id;
+    ch->tx_id  = tx_id;
+    ch->on_rx  = on_rx;
+    ch->ctx    = ctx;
+    ch->bs     = CAN_TP_DEFAULT_BS;
+    ch->stmin  = CAN_TP_DEFAULT_STMIN;
+    ch->fc_sem = xSemaphoreCreateBinary();
+
+    if (ch->fc_sem == NULL)
+        return CAN_TP_ERROR;
+
+    // Datos y FC del otro extremo tienen que pasar el filtro de aceptación
+    CAN_BSP_AddFilter(rx_id, CAN_BSP_FIFO0);
+
+    num_channels++;
+    return CAN_TP_OK;
+}
+
+can_tp_status_t CAN_TP_SetRxParams(uint32_t rx_id, uint8_t bs, uint8_t stmin)
+{
+    can_tp_channel_t *ch = can_tp_find_rx(rx_id);
+
+    if (ch == NULL)
+        return CAN_TP_ERROR;
+
+    ch->bs = bs;
+    ch->stmin = stmin;
+    return CAN_TP_OK;
+}
+
+can_tp_stats_t CAN_TP_GetStats(void)
+{
+    return stats;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Recepción                                                              */
+
+static void can_tp_deliver(can_tp_channel_t *ch, uint8_t *data, uint32_t len, uint8_t pooled)
+{
+    uint8_t keep = 0;
+
+    stats.rx_transfers++;
+    stats.rx_bytes += len;
+
+    if (ch->on_rx != NULL)
+        keep = ch->on_rx(ch->rx_id, data, len, ch->ctx);
+
+    if (pooled && !keep)
+        CAN_TP_Release(data);
+}
+
+static void can_tp_rx_first(can_tp_channel_t *ch, const can_bsp_msg_t *msg)
+{
+    uint32_t len;
+    uint8_t  off;
+
+    if (msg->dlc < 8)
+        return;
+
+    len = ((uint32_t)(msg->data[0] & 0x0F) << 8) | msg->data[1];
+    off = 2;
+
+    if (len == 0)
+    {
+        len = ((uint32_t)msg->data[2] << 24) | ((uint32_t)msg->data[3] << 16) |
+              ((uint32_t)msg->data[4] << 8)  |  msg->data[5];
+        off = 6;
+    }
+
+    // Un FF nuevo reemplaza cualquier sesión a medias en este ID
+    can_tp_rx_drop(ch);
+
+    if (len > CAN_TP_BLOCK_SIZE || (ch->rx_buf = can_tp_alloc()) == NULL)
+    {
+        stats.rx_overflows++;
+        can_tp_send_fc(ch, CAN_TP_FS_OVFLW);
+        return;
+    }
+
+    ch->rx_total = len;
+    ch->rx_got   = 8 - off;
+    ch->rx_sn    = 1;
+    ch->rx_block = 0;
+    ch->rx_start = ch->rx_tick = xTaskGetTickCount();
+    memcpy(ch->rx_buf, &msg->data[off], ch->rx_got);
+
+    can_tp_send_fc(ch, CAN_TP_FS_CTS);
+}
+
+static void can_tp_rx_consecutive(can_tp_channel_t *ch, const can_bsp_msg_t *msg)
+{
+    TickType_t now = xTaskGetTickCount();
+    uint32_t n;
+
+    if (ch->rx_buf == NULL)
+        return;
+
+    if ((now - ch->rx_tick) >= pdMS_TO_TICKS(CAN_TP_CF_TIMEOUT_MS))
+    {
+        stats.rx_timeouts++;
+        can_tp_rx_drop(ch);
+        return;
+    }
+
+    if ((msg->data[0] & 0x0F) != ch->rx_sn)
+    {
+        stats.rx_sn_errors++;
+        can_tp_rx_drop(ch);
+        return;
+    }
+
+    n = ch->rx_total - ch->rx_got;
+    if (n > (uint32_t)(msg->dlc - 1))
+        n = msg->dlc - 1;
+
+    memcpy(&ch->rx_buf[ch->rx_got], &msg->data[1], n);
+    ch->rx_got += n;
+    ch->rx_sn = (ch->rx_sn + 1) & 0x0F;
+    ch->rx_tick = now;
+
+    if (ch->rx_got >= ch->rx_total)
+    {
+        uint8_t *buf = ch->rx_buf;
+
+        // El bloque pasa al callback; la sesión queda libre para otro FF
+        ch->rx_buf = NULL;
+        stats.rx_last_bytes_per_s = can_tp_rate(ch->rx_total, ch->rx_start);
+        can_tp_deliver(ch, buf, ch->rx_total, 1);
+        return;
+    }
+
+    if (ch->bs != 0 && ++ch->rx_block >= ch->bs)
+    {
+        ch->rx_block = 0;
+        can_tp_send_fc(ch, CAN_TP_FS_CTS);
+    }
+}
+
+uint8_t CAN_TP_OnFrame(const can_bsp_msg_t *msg)
+{
+    can_tp_channel_t *ch = can_tp_find_rx(msg->id);
+
+    if (ch == NULL)
+        return 0;
+
+    if (msg->dlc < 1)
+        return 1;
+
+    switch (msg->data[0] & 0xF0)
+    {
+    case CAN_TP_PCI_SF:
+    {
+        uint8_t len = msg->data[0] & 0x0F;
+        uint8_t sf[7];
+
+        if (len == 0 || len > msg->dlc - 1)
+            break;
+
+        memcpy(sf, &msg->data[1], len);
+        can_tp_deliver(ch, sf, len, 0);
+        break;
+    }
+
+    case CAN_TP_PCI_FF:
+        can_tp_rx_first(ch, msg);
+        break;
+
+    case CAN_TP_PCI_CF:
+        can_tp_rx_consecutive(ch, msg);
+        break;
+
+    case CAN_TP_PCI_FC:
+        if (ch->tx_busy && msg->dlc >= 3)
+        {
+            ch->fc_fs    = msg->data[0] & 0x0F;
+            ch->fc_bs    = msg->data[1];
+            ch->fc_stmin = msg->data[2];
+            xSemaphoreGive(ch->fc_sem);
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    return 1;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Transmisión                                                            */
+
+static can_tp_status_t can_tp_wait_fc(can_tp_tx_t *tx)
+{
+    can_tp_channel_t *ch = tx->chan;
+    uint8_t wft = 0;
+
+    for (;;)
+    {
+        if (xSemaphoreTake(ch->fc_sem, pdMS_TO_TICKS(CAN_TP_FC_TIMEOUT_MS)) != pdTRUE)
+            return CAN_TP_TIMEOUT;
+
+        switch (ch->fc_fs)
+        {
+        case CAN_TP_FS_CTS:
+            tx->bs = ch->fc_bs;
+            tx->stmin = can_tp_stmin_ticks(ch->fc_stmin);
+            tx->block_cnt = 0;
+            tx->need_fc = 0;
+            return CAN_TP_OK;
+
+        case CAN_TP_FS_WAIT:
+            if (++wft > CAN_TP_WFT_MAX)
+                return CAN_TP_TIMEOUT;
+            break;
+
+        case CAN_TP_FS_OVFLW:
+            return CAN_TP_OVERFLOW;
+
+        default:
+            return CAN_TP_ERROR;
+        }
+    }
+}
+
+static void can_tp_tx_close(can_tp_tx_t *tx, can_tp_status_t st)
+{
+    if (tx->chan != NULL)
+    {
+        tx->chan->tx_busy = 0;
+        tx->chan = NULL;
+    }
+
+    if (st == CAN_TP_OK)
+    {
+        stats.tx_transfers++;
+        stats.tx_bytes += tx->total;
+        stats.tx_frames += tx->frames;
+        stats.tx_last_bytes_per_s = can_tp_rate(tx->total, tx->start);
+    }
+    else
+    {
+        stats.tx_errors++;
+    }
+}
+
+static can_tp_status_t can_tp_tx_frame(can_tp_tx_t *tx)
+{
+    uint8_t is_cf = (tx->frame[0] & 0xF0) == CAN_TP_PCI_CF;
+    can_tp_status_t st;
+
+    if (is_cf)
+    {
+        if (tx->need_fc)
+        {
+            st = can_tp_wait_fc(tx);
+            if (st != CAN_TP_OK)
+                return st;
+        }
+        else if (tx->stmin != 0)
+        {
+            vTaskDelay(tx->stmin);
+        }
+    }
+
+    st = can_tp_send_frame(tx->tx_id, tx->frame, tx->fill);
+    if (st != CAN_TP_OK)
+        return st;
+
+    tx->frames++;
+
+    if (!is_cf)
+        tx->need_fc = 1;    // tras el FF siempre hay FC
+    else if (tx->bs != 0 && ++tx->block_cnt >= tx->bs)
+        tx->need_fc = 1;
+
+    return CAN_TP_OK;
+}
+
+static can_tp_status_t can_tp_flush(can_tp_tx_t *tx)
+{
+    can_tp_status_t st = can_tp_tx_frame(tx);
+
+    if (st != CAN_TP_OK)
+    {
+        can_tp_tx_close(tx, st);
+        return st;
+    }
+
+    // Siguiente CF
+    tx->sn = (tx->sn + 1) & 0x0F;
+    tx->frame[0] = CAN_TP_PCI_CF | tx->sn;
+    tx->fill = 1;
+
+    return CAN_TP_OK;
+}
+
+can_tp_status_t CAN_TP_StreamBegin(can_tp_tx_t *tx, uint32_t tx_id, uint32_t total_len)
+{
+    memset(tx, 0, sizeof(*tx));
+    tx->tx_id = tx_id;
+    tx->total = total_len;
+    tx->start = xTaskGetTickCount();
+
+    if (total_len <= 7)
+    {
+        tx->frame[0] = CAN_TP_PCI_SF | total_len;
+        tx->fill = 1;
+        return CAN_TP_OK;
+    }
+
+    // Multi-trama: hace falta un canal para recibir los FC
+    tx->chan = can_tp_find_tx(tx_id);
+    if (tx->chan == NULL || tx->chan->tx_busy)
+    {
+        tx->chan = NULL;
+        return CAN_TP_ERROR;
+    }
+
+    tx->chan->tx_busy = 1;
+    xSemaphoreTake(tx->chan->fc_sem, 0);    // descartar FC antiguos
+
+    if (total_len <= CAN_TP_FF_DL_12BIT_MAX)
+    {
+        tx->frame[0] = CAN_TP_PCI_FF | (total_len >> 8);
+        tx->frame[1] = total_len & 0xFF;
+        tx->fill = 2;
+    }
+    else
+    {
+        // Escape ISO 15765-2:2016: FF_DL = 0 seguido de 32 bits
+        tx->frame[0] = CAN_TP_PCI_FF;
+        tx->frame[1] = 0;
+        tx->frame[2] = total_len >> 24;
+        tx->frame[3] = total_len >> 16;
+        tx->frame[4] = total_len >> 8;
+        tx->frame[5] = total_len & 0xFF;
+        tx->fill = 6;
+    }
+
+    return CAN_TP_OK;
+}
+
+can_tp_status_t CAN_TP_StreamWrite(can_tp_tx_t *tx, const uint8_t *data, uint32_t len)
+{
+    if (tx->queued + len > tx->total)
+        return CAN_TP_ERROR;
+
+    if (tx->total > 7 && tx->chan == NULL)
+        return CAN_TP_ERROR;    // sesión cerrada por un error anterior
+
+    while (len > 0)
+    {
+        uint8_t n = 8 - tx->fill;
+        if (n > len)
+            n = len;
+
+        memcpy(&tx->frame[tx->fill], data, n);
+        tx->fill += n;
+        tx->queued += n;
+        data += n;
+        len -= n;
+
+        // Trama completa (la SF se envía en StreamEnd)
+        if (tx->fill == 8 && tx->total > 7)
+        {
+            can_tp_status_t st = can_tp_flush(tx);
+            if (st != CAN_TP_OK)
+                return st;
+        }
+    }
+
+    return CAN_TP_OK;
+}
+
+can_tp_status_t CAN_TP_StreamEnd(can_tp_tx_t *tx)
+{
+    can_tp_status_t st = CAN_TP_OK;
+
+    if (tx->total > 7 && tx->chan == NULL)
+        return CAN_TP_ERROR;
+
+    if (tx->queued != tx->total)
+        st = CAN_TP_ERROR;
+    else if (tx->fill > 1)
+        st = can_tp_tx_frame(tx);   // última trama parcial (o SF), sin relleno
+
+    can_tp_tx_close(tx, st);
+    return st;
+}
+
+can_tp_status_t CAN_TP_Send(uint32_t tx_id, const uint8_t *data, uint32_t len)
+{
+    can_tp_tx_t tx;
+    can_tp_status_t st;
+
+    st = CAN_TP_StreamBegin(&tx, tx_id, len);
+    if (st == CAN_TP_OK)
+        st = CAN_TP_StreamWrite(&tx, data, len);
+    if (st == CAN_TP_OK)
+        st = CAN_TP_StreamEnd(&tx);
+
+    return st;
+}
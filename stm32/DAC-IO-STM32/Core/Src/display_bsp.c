@@ -6,6 +6,38 @@
  */
 
 #include "display_bsp.h"
+#include "FreeRTOS.h"
+#include "semphr.h"
+
+/*
+ * Los datos de pantalla salen por DMA (SPI1_TX, DMA2 Stream 3): la tarea
+ * arranca la transferencia y espera en un semáforo que da el callback de
+ * fin, con CS todavía bajo hasta entonces. Mientras, la CPU queda libre
+ * para las demás tareas. Los comandos sueltos van por polling en una
+ * sola ráfaga con CS bajo (son pocos bytes, no compensa la DMA) y antes
+ * esperan a que termine la DMA en curso.
+ */
+static SemaphoreHandle_t tx_done_sem;
+static uint8_t tx_pending;          // solo lo toca la tarea de pantalla
+static volatile uint8_t tx_error;
+
+/*
+ * Lote de tramos (ventanas 0x21/0x22 y datos) que la ISR de fin de DMA
+ * encadena sin volver a la tarea: así una actualización con varias
+ * ventanas entera puede ir en segundo plano mientras se dibuja la
+ * siguiente. Los datos deben seguir intactos hasta WaitTransfer.
+ */
+typedef struct {
+    uint8_t *data;
+    uint16_t len;
+    uint8_t  is_data;               // 1 = DC alto
+} ssd1309_segment_t;
+
+static ssd1309_segment_t batch[SSD1309_MAX_SEGMENTS];
+static uint8_t batch_windows[SSD1309_PAGES][6];
+static uint8_t batch_count;
+static uint8_t batch_nwin;
+static volatile uint8_t batch_next;
 
 /* ========= FUNCIONES INTERNAS ========= */
 
@@ -31,83 +63,277 @@ void BSP_SSD1309_Reset(void)
 
 /* ========= ENVÍO COMANDO ========= */
 
-void BSP_SSD1309_SendCommand(uint8_t cmd)
+// Bytes de comando con CS ya bajo; HAL_SPI_Transmit vuelve con BSY = 0
+static void SSD1309_WriteCommands(const uint8_t *cmds, uint16_t len)
 {
     HAL_GPIO_WritePin(SSD1309_DC_PORT, SSD1309_DC_PIN, GPIO_PIN_RESET);
+    HAL_SPI_Transmit(&hspi1, (uint8_t *)cmds, len, HAL_MAX_DELAY);
+}
+
+// Arranca un tramo con CS ya bajo. Se llama también desde la ISR
+static HAL_StatusTypeDef SSD1309_StartSegment(const ssd1309_segment_t *seg)
+{
+    HAL_GPIO_WritePin(SSD1309_DC_PORT, SSD1309_DC_PIN, seg->is_data ? GPIO_PIN_SET : GPIO_PIN_RESET);
+    return HAL_SPI_Transmit_DMA(&hspi1, seg->data, seg->len);
+}
+
+void BSP_SSD1309_SendCommand(uint8_t cmd)
+{
+    BSP_SSD1309_SendCommands(&cmd, 1);
+}
+
+void BSP_SSD1309_SendCommands(const uint8_t *cmds, uint16_t len)
+{
+    BSP_SSD1309_WaitTransfer();
+
     SSD1309_Select();
-    HAL_SPI_Transmit(&hspi1, &cmd, 1, HAL_MAX_DELAY);
+    SSD1309_WriteCommands(cmds, len);
     SSD1309_Unselect();
 }
 
+/* ========= LOTES DE TRAMOS ========= */
+
+bool BSP_SSD1309_BatchBegin(void)
+{
+    bool ok = BSP_SSD1309_WaitTransfer();
+
+    batch_count = 0;
+    batch_nwin = 0;
+    return ok;
+}
+
+bool BSP_SSD1309_BatchWindow(uint8_t x0, uint8_t x1, uint8_t page0, uint8_t page1)
+{
+    uint8_t *win;
+
+    if (batch_count >= SSD1309_MAX_SEGMENTS || batch_nwin >= SSD1309_PAGES)
+        return false;
+
+    win = batch_windows[batch_nwin++];
+    win[0] = 0x21;      // Column addr
+    win[1] = x0;
+    win[2] = x1;
+    win[3] = 0x22;      // Page addr
+    win[4] = page0;
+    win[5] = page1;
+
+    batch[batch_count].data = win;
+    batch[batch_count].len = 6;
+    batch[batch_count].is_data = 0;
+    batch_count++;
+    return true;
+}
+
+bool BSP_SSD1309_BatchData(uint8_t* data, uint16_t size)
+{
+    if (batch_count >= SSD1309_MAX_SEGMENTS)
+        return false;
+
+    batch[batch_count].data = data;
+    batch[batch_count].len = size;
+    batch[batch_count].is_data = 1;
+    batch_count++;
+    return true;
+}
+
+bool BSP_SSD1309_BatchStart(void)
+{
+    bool ok = true;
+
+    if (batch_count == 0)
+        return true;
+
+    SSD1309_Select();
+
+    if (tx_done_sem == NULL)
+    {
+        // Sin semáforo (antes del Init): envío bloqueante
+        for (uint8_t i = 0; i < batch_count; i++)
+        {
+            HAL_GPIO_WritePin(SSD1309_DC_PORT, SSD1309_DC_PIN, batch[i].is_data ? GPIO_PIN_SET : GPIO_PIN_RESET);
+            if (HAL_SPI_Transmit(&hspi1, batch[i].data, batch[i].len, HAL_MAX_DELAY) != HAL_OK)
+                ok = false;
+        }
+        SSD1309_Unselect();
+        return ok;
+    }
+
+    tx_error = 0;
+    batch_next = 1;
+    if (SSD1309_StartSegment(&batch[0]) != HAL_OK)
+    {
+        SSD1309_Unselect();
+        return false;
+    }
+
+    tx_pending = 1;
+    return true;
+}
+
 /* ========= ENVÍO DATOS ========= */
 
 void BSP_SSD1309_SendData(uint8_t* data, uint16_t size)
 {
-    HAL_GPIO_WritePin(SSD1309_DC_PORT, SSD1309_DC_PIN, GPIO_PIN_SET);
-    SSD1309_Select();
-    HAL_SPI_Transmit(&hspi1, data, size, HAL_MAX_DELAY);
-    SSD1309_Unselect();
+    BSP_SSD1309_SendDataAsync(data, size);
+    BSP_SSD1309_WaitTransfer();
 }
 
-/* ========= INICIALIZACIÓN ========= */
+void BSP_SSD1309_SendDataAsync(uint8_t* data, uint16_t size)
+{
+    BSP_SSD1309_BatchBegin();
+    BSP_SSD1309_BatchData(data, size);
+    BSP_SSD1309_BatchStart();
+}
 
-void BSP_SSD1309_Init(void)
+bool BSP_SSD1309_WaitTransfer(void)
 {
-    BSP_SSD1309_Reset();
+    if (!tx_pending)
+        return true;
+
+    tx_pending = 0;
+
+    if (xSemaphoreTake(tx_done_sem, pdMS_TO_TICKS(SSD1309_DMA_TIMEOUT_MS)) != pdTRUE)
+    {
+        // La DMA no terminó: abortar y soltar CS para no bloquear el bus
+        batch_next = batch_count;
+        HAL_SPI_Abort(&hspi1);
+        SSD1309_Unselect();
+
+        // Si la DMA terminó justo durante el abort, su give quedaría para
+        // la siguiente transferencia y la daría por acabada antes de tiempo
+        xSemaphoreTake(tx_done_sem, 0);
+        return false;
+    }
+
+    return !tx_error;
+}
+
+/* ========= FIN DE DMA (ISR) ========= */
 
-    BSP_SSD1309_SendCommand(0xAE); // Display OFF
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    BaseType_t hpw = pdFALSE;
 
-    BSP_SSD1309_SendCommand(0xD5);
-    BSP_SSD1309_SendCommand(0x80);
+    if (hspi != &hspi1)
+        return;
 
-    BSP_SSD1309_SendCommand(0xA8);
-    BSP_SSD1309_SendCommand(0x3F); // 64 líneas
+    // El HAL ya esperó a BSY = 0: se puede cambiar DC o soltar CS
+    if (batch_next < batch_count)
+    {
+        if (SSD1309_StartSegment(&batch[batch_next++]) == HAL_OK)
+            return;
 
-    BSP_SSD1309_SendCommand(0xD3);
-    BSP_SSD1309_SendCommand(0x00);
+        tx_error = 1;
+    }
 
-    BSP_SSD1309_SendCommand(0x40);
+    SSD1309_Unselect();
 
-    BSP_SSD1309_SendCommand(0x8D);
-    BSP_SSD1309_SendCommand(0x14);
+    xSemaphoreGiveFromISR(tx_done_sem, &hpw);
+    portYIELD_FROM_ISR(hpw);
+}
 
-    BSP_SSD1309_SendCommand(0x20);
-    BSP_SSD1309_SendCommand(0x00); // Horizontal addressing mode
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+{
+    BaseType_t hpw = pdFALSE;
 
-    BSP_SSD1309_SendCommand(0xA1);
-    BSP_SSD1309_SendCommand(0xC8);
+    if (hspi != &hspi1)
+        return;
 
-    BSP_SSD1309_SendCommand(0xDA);
-    BSP_SSD1309_SendCommand(0x12);
+    SSD1309_Unselect();
+    batch_next = batch_count;
+    tx_error = 1;
 
-    BSP_SSD1309_SendCommand(0x81);
-    BSP_SSD1309_SendCommand(0xCF);
+    xSemaphoreGiveFromISR(tx_done_sem, &hpw);
+    portYIELD_FROM_ISR(hpw);
+}
 
-    BSP_SSD1309_SendCommand(0xD9);
-    BSP_SSD1309_SendCommand(0xF1);
+/* ========= INICIALIZACIÓN ========= */
 
-    BSP_SSD1309_SendCommand(0xDB);
-    BSP_SSD1309_SendCommand(0x40);
+/* Secuencia de arranque: se envía entera con un solo CS bajo */
+static const uint8_t ssd1309_init_seq[] = {
+    0xAE,               // Display OFF
+    0xD5, 0x80,         // Reloj / divisor
+    0xA8, 0x3F,         // 64 líneas
+    0xD3, 0x00,         // Sin offset vertical
+    0x40,               // Línea de inicio 0
+    0x8D, 0x14,         // Charge pump
+    0x20, 0x00,         // Horizontal addressing mode
+    0xA1,               // Segment remap
+    0xC8,               // Barrido COM invertido
+    0xDA, 0x12,         // Pines COM
+    0x81, SSD1309_DEFAULT_CONTRAST,
+    0xD9, 0xF1,         // Precarga
+    0xDB, 0x40,         // VCOMH
+    0xA4,               // Mostrar RAM
+    0xA6,               // Normal (no invertido)
+    0xAF,               // Display ON
+};
+
+void BSP_SSD1309_Init(void)
+{
+    if (tx_done_sem == NULL)
+        tx_done_sem = xSemaphoreCreateBinary();
 
-    BSP_SSD1309_SendCommand(0xA4);
-    BSP_SSD1309_SendCommand(0xA6);
+    BSP_SSD1309_Reset();
 
-    BSP_SSD1309_SendCommand(0xAF); // Display ON
+    BSP_SSD1309_SendCommands(ssd1309_init_seq, sizeof(ssd1309_init_seq));
 }
 
 /* ========= ACTUALIZAR PANTALLA ========= */
 
 void BSP_SSD1309_UpdateScreen(uint8_t* buffer)
 {
-    BSP_SSD1309_SendCommand(0x21); // Column addr
-    BSP_SSD1309_SendCommand(0);
-    BSP_SSD1309_SendCommand(127);
+    BSP_SSD1309_UpdateRegion(buffer, 0, SSD1309_WIDTH - 1, 0, SSD1309_PAGES - 1);
+}
+
+/* ========= ACTUALIZAR UNA ZONA ========= */
+
+void BSP_SSD1309_SetWindow(uint8_t x0, uint8_t x1, uint8_t page0, uint8_t page1)
+{
+    const uint8_t window[] = {
+        0x21, x0, x1,           // Column addr
+        0x22, page0, page1,     // Page addr
+    };
+
+    BSP_SSD1309_SendCommands(window, sizeof(window));
+}
+
+void BSP_SSD1309_UpdateRegion(uint8_t* buffer, uint8_t x0, uint8_t x1, uint8_t page0, uint8_t page1)
+{
+    BSP_SSD1309_BatchBegin();
+    BSP_SSD1309_BatchRegion(buffer, x0, x1, page0, page1);
+    BSP_SSD1309_BatchStart();
+    BSP_SSD1309_WaitTransfer();
+}
+
+bool BSP_SSD1309_BatchRegion(uint8_t* buffer, uint8_t x0, uint8_t x1, uint8_t page0, uint8_t page1)
+{
+    uint8_t width = x1 - x0 + 1;
+
+    if (!BSP_SSD1309_BatchWindow(x0, x1, page0, page1))
+        return false;
 
-    BSP_SSD1309_SendCommand(0x22); // Page addr
-    BSP_SSD1309_SendCommand(0);
-    BSP_SSD1309_SendCommand(7);
+    // Ancho completo: las páginas son contiguas en el buffer, un solo tramo
+    if (width == SSD1309_WIDTH)
+        return BSP_SSD1309_BatchData(&buffer[page0 * SSD1309_WIDTH], (page1 - page0 + 1) * SSD1309_WIDTH);
+
+    // El controlador salta solo a la siguiente página de la ventana
+    for (uint8_t page = page0; page <= page1; page++)
+    {
+        if (!BSP_SSD1309_BatchData(&buffer[page * SSD1309_WIDTH + x0], width))
+            return false;
+    }
+
+    return true;
+}
+
+/* ========= CONTRASTE ========= */
+
+void BSP_SSD1309_SetContrast(uint8_t contrast)
+{
+    const uint8_t cmds[] = { 0x81, contrast };
 
-    BSP_SSD1309_SendData(buffer, SSD1309_WIDTH * SSD1309_HEIGHT / 8);
+    BSP_SSD1309_SendCommands(cmds, sizeof(cmds));
 }
 
 /* ========= LIMPIAR BUFFER ========= */
@@ -8,16 +8,67 @@
 #include "display_driver.h"
 #include "display_font.h"
 #include "display_bsp.h"
+#include "FreeRTOS.h"
+#include "task.h"
 #include <string.h>
 #include <stdlib.h>
 
+/* Column span touched in one page (x0 > x1: nothing) */
+typedef struct {
+    uint8_t x0;
+    uint8_t x1;
+} display_span_t;
+
 /* Private variables */
-static uint8_t display_buffer[SSD1309_WIDTH * SSD1309_HEIGHT / 8];
+static uint8_t display_buffers[2][SSD1309_WIDTH * SSD1309_HEIGHT / 8];
+static uint8_t *display_buffer = display_buffers[0];   // back buffer: drawing goes here
 static bool is_initialized = false;
 
+/* Frame pacing for Display_Swap */
+static TickType_t frame_period = pdMS_TO_TICKS(DISPLAY_FRAME_MS);
+static TickType_t frame_last;
+
+/*
+ * dirty: what changed since the last Display_Update and has to be sent.
+ * drawn: what holds pixels since the last Display_Clear. Clearing only
+ * dirties that area, so a redraw of the same screen sends the old and new
+ * content spans instead of all 1024 bytes.
+ */
+static display_span_t dirty[DISPLAY_PAGES];
+static display_span_t drawn[DISPLAY_PAGES];
+static display_update_stats_t update_stats;
 
 /* Private function prototypes */
-static const uint8_t* get_font_data(char c, font_size_t font);
+static void display_present(void);
+
+static inline void span_reset(display_span_t *span)
+{
+    span->x0 = 0xFF;
+    span->x1 = 0;
+}
+
+static inline void span_add(display_span_t *span, uint8_t x0, uint8_t x1)
+{
+    if (x0 < span->x0) {
+        span->x0 = x0;
+    }
+    if (x1 > span->x1) {
+        span->x1 = x1;
+    }
+}
+
+/* Page byte bits from row n down to the bottom / from the top down to row n */
+static const uint8_t mask_from_row[8] = { 0xFF, 0xFE, 0xFC, 0xF8, 0xF0, 0xE0, 0xC0, 0x80 };
+static const uint8_t mask_to_row[8]   = { 0x01, 0x03, 0x07, 0x0F, 0x1F, 0x3F, 0x7F, 0xFF };
+
+/* Columns x0-x1 of pages page0-page1 were written (already clipped) */
+static void mark_dirty(uint8_t x0, uint8_t x1, uint8_t page0, uint8_t page1)
+{
+    for (uint8_t page = page0; page <= page1; page++) {
+        span_add(&dirty[page], x0, x1);
+        span_add(&drawn[page], x0, x1);
+    }
+}
 
 /**
  * @brief Initialize display driver
@@ -27,14 +78,15 @@ bool Display_Init(void)
     /* Initialize BSP layer */
     BSP_SSD1309_Init();
 
-    /* Clear buffer */
+    /* Clear buffer; the panel RAM is unknown, so send everything once */
     Display_Clear();
+    Display_Invalidate();
+
+    is_initialized = true;
 
     /* Update display */
     Display_Update();
 
-    is_initialized = true;
-
     return true;
 }
 
@@ -44,10 +96,106 @@ bool Display_Init(void)
 void Display_Clear(void)
 {
     BSP_SSD1309_Clear(display_buffer);
+
+    for (uint8_t page = 0; page < DISPLAY_PAGES; page++) {
+        if (drawn[page].x0 <= drawn[page].x1) {
+            span_add(&dirty[page], drawn[page].x0, drawn[page].x1);
+        }
+        span_reset(&drawn[page]);
+    }
 }
 
 /**
- * @brief Update display
+ * @brief Queue the dirty regions of a buffer in the BSP batch
+ * @param sent: SPI bytes queued
+ * @retval false if the batch was full and some region was left out
+ */
+static bool display_queue_dirty(uint8_t *buffer, uint16_t *sent)
+{
+    bool ok = true;
+    uint8_t page = 0;
+
+    *sent = 0;
+
+    while (page < DISPLAY_PAGES) {
+        if (dirty[page].x0 > dirty[page].x1) {
+            page++;
+            continue;
+        }
+
+        uint8_t page0 = page;
+        uint8_t page1 = page;
+        uint8_t x0 = dirty[page].x0;
+        uint8_t x1 = dirty[page].x1;
+
+        /* Merge the next dirty page while one wider window costs no more
+         * than a second window */
+        while (page1 + 1 < DISPLAY_PAGES && dirty[page1 + 1].x0 <= dirty[page1 + 1].x1) {
+            const display_span_t *next = &dirty[page1 + 1];
+            uint8_t mx0 = (next->x0 < x0) ? next->x0 : x0;
+            uint8_t mx1 = (next->x1 > x1) ? next->x1 : x1;
+            uint16_t merged = (page1 - page0 + 2) * (mx1 - mx0 + 1);
+            uint16_t separate = (page1 - page0 + 1) * (x1 - x0 + 1)
+                              + DISPLAY_WINDOW_COST + (next->x1 - next->x0 + 1);
+
+            if (merged > separate) {
+                break;
+            }
+
+            x0 = mx0;
+            x1 = mx1;
+            page1++;
+        }
+
+        if (BSP_SSD1309_BatchRegion(buffer, x0, x1, page0, page1)) {
+            *sent += DISPLAY_WINDOW_COST + (page1 - page0 + 1) * (x1 - x0 + 1);
+        } else {
+            ok = false;
+        }
+        page = page1 + 1;
+    }
+
+    for (page = 0; page < DISPLAY_PAGES; page++) {
+        span_reset(&dirty[page]);
+    }
+
+    return ok;
+}
+
+/**
+ * @brief Start sending the back buffer and flip to the other one
+ *
+ * The buffer just drawn becomes the front buffer and goes out by DMA in
+ * the background. Drawing continues in the other buffer, which starts as
+ * a copy of this frame so the dirty/drawn spans stay valid for both.
+ */
+static void display_present(void)
+{
+    uint8_t *front = display_buffer;
+    uint16_t sent;
+    bool ok;
+
+    /* Waits for the previous frame. Whatever did not reach the panel has
+     * already been cleared from the dirty spans: resend the whole screen */
+    ok = BSP_SSD1309_BatchBegin();
+    ok = display_queue_dirty(front, &sent) && ok;
+    ok = BSP_SSD1309_BatchStart() && ok;
+    if (!ok) {
+        Display_Invalidate();
+    }
+
+    display_buffer = (front == display_buffers[0]) ? display_buffers[1] : display_buffers[0];
+    memcpy(display_buffer, front, sizeof(display_buffers[0]));
+
+    if (sent > 0) {
+        update_stats.updates++;
+        update_stats.bytes += sent;
+        update_stats.last_bytes = sent;
+    }
+}
+
+/**
+ * @brief Update display (dirty regions only) and wait for the transfer
  */
 void Display_Update(void)
 {
@@ -55,7 +203,65 @@ void Display_Update(void)
         return;
     }
 
-    BSP_SSD1309_UpdateScreen(display_buffer);
+    display_present();
+    if (!BSP_SSD1309_WaitTransfer()) {
+        Display_Invalidate();
+    }
+}
+
+/**
+ * @brief Present the frame at the target rate; render the next one meanwhile
+ */
+void Display_Swap(void)
+{
+    TickType_t now;
+
+    if (!is_initialized) {
+        return;
+    }
+
+    now = xTaskGetTickCount();
+
+    if (now - frame_last > DISPLAY_PACING_RESYNC * frame_period) {
+        /* First frame of a new animation: start the cadence here */
+        frame_last = now;
+    } else if (now - frame_last > frame_period) {
+        /* Rendering took longer than a frame: do not try to catch up */
+        update_stats.late_frames++;
+        frame_last = now;
+    } else {
+        vTaskDelayUntil(&frame_last, frame_period);
+    }
+
+    update_stats.frames++;
+    display_present();
+}
+
+/**
+ * @brief Set the Display_Swap frame period
+ */
+void Display_SetFramePeriod(uint16_t ms)
+{
+    frame_period = pdMS_TO_TICKS(ms) ? pdMS_TO_TICKS(ms) : 1;
+}
+
+/**
+ * @brief Force a full-screen update
+ */
+void Display_Invalidate(void)
+{
+    for (uint8_t page = 0; page < DISPLAY_PAGES; page++) {
+        dirty[page].x0 = 0;
+        dirty[page].x1 = DISPLAY_WIDTH - 1;
+    }
+}
+
+/**
+ * @brief Get update statistics
+ */
+display_update_stats_t Display_GetUpdateStats(void)
+{
+    return update_stats;
 }
 
 /**
@@ -74,13 +280,105 @@ void Display_DrawPixel(uint8_t x, uint8_t y, color_t color)
     } else {
         display_buffer[index] &= ~(1 << (y % 8));
     }
+
+    mark_dirty(x, x, y / 8, y / 8);
 }
 
 /**
- * @brief Draw a line (Bresenham's algorithm)
+ * @brief Fill columns x0-x1 of rows y0-y1 (already clipped) a page byte at a time
+ *
+ * Only the first and last page need a mask; the pages in between are
+ * whole bytes and go through memset.
+ */
+static void fill_clipped(uint8_t x0, uint8_t x1, uint8_t y0, uint8_t y1, color_t color)
+{
+    uint8_t page0 = y0 / 8;
+    uint8_t page1 = y1 / 8;
+    uint8_t width = x1 - x0 + 1;
+
+    for (uint8_t page = page0; page <= page1; page++) {
+        uint8_t *row = &display_buffer[page * DISPLAY_WIDTH + x0];
+        uint8_t mask = 0xFF;
+
+        if (page == page0) {
+            mask &= mask_from_row[y0 % 8];
+        }
+        if (page == page1) {
+            mask &= mask_to_row[y1 % 8];
+        }
+
+        if (mask == 0xFF) {
+            memset(row, (color == COLOR_WHITE) ? 0xFF : 0x00, width);
+        } else if (color == COLOR_WHITE) {
+            for (uint8_t i = 0; i < width; i++) {
+                row[i] |= mask;
+            }
+        } else {
+            for (uint8_t i = 0; i < width; i++) {
+                row[i] &= ~mask;
+            }
+        }
+    }
+
+    mark_dirty(x0, x1, page0, page1);
+}
+
+/**
+ * @brief Clip a rectangle to the screen
+ * @retval false if nothing is left; otherwise x1/y1 hold the last column/row
+ */
+static bool clip_rect(uint8_t x, uint8_t y, uint16_t w, uint16_t h, uint8_t *x1, uint8_t *y1)
+{
+    if (w == 0 || h == 0 || x >= DISPLAY_WIDTH || y >= DISPLAY_HEIGHT) {
+        return false;
+    }
+
+    *x1 = (x + w > DISPLAY_WIDTH) ? DISPLAY_WIDTH - 1 : x + w - 1;
+    *y1 = (y + h > DISPLAY_HEIGHT) ? DISPLAY_HEIGHT - 1 : y + h - 1;
+    return true;
+}
+
+/**
+ * @brief Draw a horizontal line
+ */
+void Display_DrawHLine(uint8_t x, uint8_t y, uint8_t w, color_t color)
+{
+    uint8_t x1, y1;
+
+    if (clip_rect(x, y, w, 1, &x1, &y1)) {
+        fill_clipped(x, x1, y, y1, color);
+    }
+}
+
+/**
+ * @brief Draw a vertical line
+ */
+void Display_DrawVLine(uint8_t x, uint8_t y, uint8_t h, color_t color)
+{
+    uint8_t x1, y1;
+
+    if (clip_rect(x, y, 1, h, &x1, &y1)) {
+        fill_clipped(x, x1, y, y1, color);
+    }
+}
+
+/**
+ * @brief Draw a line (Bresenham's algorithm; straight lines are byte-wise)
  */
 void Display_DrawLine(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, color_t color)
 {
+    if (y0 == y1) {
+        uint8_t left = (x0 < x1) ? x0 : x1;
+        Display_DrawHLine(left, y0, abs(x1 - x0) + 1, color);
+        return;
+    }
+
+    if (x0 == x1) {
+        uint8_t top = (y0 < y1) ? y0 : y1;
+        Display_DrawVLine(x0, top, abs(y1 - y0) + 1, color);
+        return;
+    }
+
     int dx = abs(x1 - x0);
     int dy = abs(y1 - y0);
     int sx = (x0 < x1) ? 1 : -1;
@@ -113,10 +411,14 @@ void Display_DrawLine(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, color_t co
  */
 void Display_DrawRect(uint8_t x, uint8_t y, uint8_t w, uint8_t h, color_t color)
 {
-    Display_DrawLine(x, y, x + w - 1, y, color);             // Top
-    Display_DrawLine(x, y + h - 1, x + w - 1, y + h - 1, color); // Bottom
-    Display_DrawLine(x, y, x, y + h - 1, color);             // Left
-    Display_DrawLine(x + w - 1, y, x + w - 1, y + h - 1, color); // Right
+    if (w == 0 || h == 0) {
+        return;
+    }
+
+    Display_DrawHLine(x, y, w, color);                  // Top
+    Display_DrawHLine(x, y + h - 1, w, color);          // Bottom
+    Display_DrawVLine(x, y, h, color);                  // Left
+    Display_DrawVLine(x + w - 1, y, h, color);          // Right
 }
 
 /**
@@ -124,8 +426,10 @@ void Display_DrawRect(uint8_t x, uint8_t y, uint8_t w, uint8_t h, color_t color)
  */
 void Display_FillRect(uint8_t x, uint8_t y, uint8_t w, uint8_t h, color_t color)
 {
-    for (uint8_t i = 0; i < h; i++) {
-        Display_DrawLine(x, y + i, x + w - 1, y + i, color);
+    uint8_t x1, y1;
+
+    if (clip_rect(x, y, w, h, &x1, &y1)) {
+        fill_clipped(x, x1, y, y1, color);
     }
 }
 
@@ -159,27 +463,108 @@ void Display_DrawCircle(uint8_t x0, uint8_t y0, uint8_t r, color_t color)
 }
 
 /**
- * @brief Draw a character
+ * @brief OR (or clear) 8-pixel-high glyph columns into the buffer
+ *
+ * The font is stored one byte per column, LSB on top, the same layout as
+ * a page of the SSD1309. At a page-aligned y each column is a single byte
+ * operation; otherwise it is split between two pages. Does not mark dirty.
+ * @retval Columns written after clipping
  */
-void Display_DrawChar(uint8_t x, uint8_t y, char c, font_size_t font, color_t color)
+static uint8_t blit_columns(uint8_t x, uint8_t y, const uint8_t *columns, uint8_t width, color_t color)
 {
-    const uint8_t *font_data = get_font_data(c, font);
+    if (x >= DISPLAY_WIDTH || y >= DISPLAY_HEIGHT) {
+        return 0;
+    }
 
-    if (font_data == NULL) {
-        return;
+    if (width > DISPLAY_WIDTH - x) {
+        width = DISPLAY_WIDTH - x;
     }
 
-    uint8_t font_width = 6;  // For 6x8 font
-    uint8_t font_height = 8;
+    uint8_t page = y / 8;
+    uint8_t shift = y % 8;
+    uint8_t *top = &display_buffer[page * DISPLAY_WIDTH + x];
 
-    for (uint8_t i = 0; i < font_width; i++) {
-        uint8_t line = font_data[i];
-        for (uint8_t j = 0; j < font_height; j++) {
-            if (line & 0x01) {
-                Display_DrawPixel(x + i, y + j, color);
+    if (shift == 0) {
+        if (color == COLOR_WHITE) {
+            for (uint8_t i = 0; i < width; i++) {
+                top[i] |= columns[i];
+            }
+        } else {
+            for (uint8_t i = 0; i < width; i++) {
+                top[i] &= ~columns[i];
             }
-            line >>= 1;
         }
+        return width;
+    }
+
+    /* On the last page the lower half of the glyph falls off the screen */
+    uint8_t *bottom = (page + 1 < DISPLAY_PAGES) ? top + DISPLAY_WIDTH : NULL;
+
+    if (color == COLOR_WHITE) {
+        for (uint8_t i = 0; i < width; i++) {
+            top[i] |= columns[i] << shift;
+        }
+        if (bottom) {
+            for (uint8_t i = 0; i < width; i++) {
+                bottom[i] |= columns[i] >> (8 - shift);
+            }
+        }
+    } else {
+        for (uint8_t i = 0; i < width; i++) {
+            top[i] &= ~(columns[i] << shift);
+        }
+        if (bottom) {
+            for (uint8_t i = 0; i < width; i++) {
+                bottom[i] &= ~(columns[i] >> (8 - shift));
+            }
+        }
+    }
+
+    return width;
+}
+
+/* Last page covered by a text row of `pages` pages starting at y (y < DISPLAY_HEIGHT) */
+static uint8_t text_last_page(uint8_t y, uint8_t pages)
+{
+    uint16_t page = (y + 8 * pages - 1) / 8;
+
+    return (page < DISPLAY_PAGES) ? page : DISPLAY_PAGES - 1;
+}
+
+/**
+ * @brief Blit every page of a glyph
+ * @retval Columns written after clipping
+ */
+static uint8_t draw_glyph(uint8_t x, uint8_t y, const display_glyph_t *glyph, color_t color)
+{
+    uint8_t written = 0;
+
+    if (glyph->columns == NULL) {
+        return 0;
+    }
+
+    for (uint8_t p = 0; p < glyph->pages && y + 8 * p < DISPLAY_HEIGHT; p++) {
+        written = blit_columns(x, y + 8 * p, glyph->columns + p * glyph->width,
+                               glyph->width, color);
+    }
+
+    return written;
+}
+
+/**
+ * @brief Draw a character
+ */
+void Display_DrawChar(uint8_t x, uint8_t y, char c, font_size_t font, color_t color)
+{
+    uint8_t scratch[FONT_GLYPH_MAX_BYTES];
+    display_glyph_t glyph;
+
+    Font_GetGlyph(font, c, scratch, &glyph);
+
+    uint8_t written = draw_glyph(x, y, &glyph, color);
+
+    if (written > 0) {
+        mark_dirty(x, x + written - 1, y / 8, text_last_page(y, glyph.pages));
     }
 }
 
@@ -188,39 +573,88 @@ void Display_DrawChar(uint8_t x, uint8_t y, char c, font_size_t font, color_t co
  */
 void Display_DrawString(uint8_t x, uint8_t y, const char *str, font_size_t font, color_t color)
 {
-    uint8_t font_width = 6;  // For 6x8 font
-    uint8_t cursor_x = x;
+    uint8_t scratch[FONT_GLYPH_MAX_BYTES];
+    display_glyph_t glyph;
+    uint16_t cursor_x = x;
+    uint16_t right = x;         // one past the last column drawn
+    const uint8_t *table;
+    char first, last;
+    uint8_t width;
+
+    if (y >= DISPLAY_HEIGHT) {
+        return;
+    }
+
+    /* Fixed 6x8 cell: resolve the font once and index its table directly */
+    table = Font_GetFixedTable(font, &first, &last, &width);
+    if (table != NULL) {
+        while (*str && cursor_x + width <= DISPLAY_WIDTH) {
+            char c = *str++;
+
+            if (c >= first && c <= last) {
+                blit_columns(cursor_x, y, &table[(c - first) * width], width, color);
+            }
+            cursor_x += width;
+        }
+
+        if (cursor_x > x) {
+            mark_dirty(x, cursor_x - 1, y / 8, text_last_page(y, 1));
+        }
+        return;
+    }
 
     while (*str) {
-        if (cursor_x + font_width > DISPLAY_WIDTH) {
+        Font_GetGlyph(font, *str, scratch, &glyph);
+
+        if (cursor_x + glyph.width > DISPLAY_WIDTH) {
             break;  // Out of screen
         }
 
-        Display_DrawChar(cursor_x, y, *str, font, color);
-        cursor_x += font_width;
+        if (draw_glyph(cursor_x, y, &glyph, color) > 0) {
+            right = cursor_x + glyph.width;
+        }
+        cursor_x += glyph.advance;
         str++;
     }
+
+    /* One dirty span for the whole string */
+    if (right > x) {
+        mark_dirty(x, right - 1, y / 8, text_last_page(y, Font_GetPages(font)));
+    }
 }
 
 /**
- * @brief Get display buffer pointer
+ * @brief Width of a string as Display_DrawString would draw it
  */
-uint8_t* Display_GetBuffer(void)
+uint16_t Display_GetTextWidth(const char *str, font_size_t font)
 {
-    return display_buffer;
+    uint16_t cursor_x = 0;
+    uint16_t width = 0;
+    uint8_t glyph_width, advance;
+
+    while (*str) {
+        Font_GetMetrics(font, *str, &glyph_width, &advance);
+        width = cursor_x + glyph_width;
+        cursor_x += advance;
+        str++;
+    }
+
+    return width;
 }
 
 /**
- * @brief Get font data for character
+ * @brief Set panel contrast
  */
-static const uint8_t* get_font_data(char c, font_size_t font)
+void Display_SetContrast(uint8_t contrast)
 {
-    // Only printable ASCII characters supported
-    if (c < 32 || c > 126)
-    {
-        c = 32;  // Space as fallback
-    }
-
-    return font_6x8[c - 32];
+    BSP_SSD1309_SetContrast(contrast);
 }
 
+/**
+ * @brief Get display buffer pointer
+ */
+uint8_t* Display_GetBuffer(void)
+{
+    mark_dirty(0, DISPLAY_WIDTH - 1, 0, DISPLAY_PAGES - 1);
+    return display_buffer;
+}
@@ -0,0 +1,373 @@
+/**
+ ******************************************************************************
+ * @file           : display_font.c
+ * @brief          : Font engine: glyph tables and decoding
+ ******************************************************************************
+ *
+ * Every font is stored in the SSD1309 page format (one byte per column,
+ * LSB on top) so the driver can OR glyphs straight into its buffer:
+ *
+ *  - FONT_6X8: the 6x8 table as is, fixed 6-pixel cell.
+ *  - FONT_6X8_PROP: the same table, with the blank columns of each glyph
+ *    trimmed at draw time and one column of spacing. No extra flash.
+ *  - FONT_12X16: the same table with every pixel doubled at draw time.
+ *  - FONT_DIGITS_14X24: seven-segment digits, RLE-compressed (281 bytes
+ *    instead of 480), generated by Host/font_gen.py.
+ */
+
+#include "display_font.h"
+#include <stddef.h>
+
+/* How a font's glyphs are stored */
+typedef enum {
+    FONT_FORMAT_FIXED = 0,
+    FONT_FORMAT_PROPORTIONAL,
+    FONT_FORMAT_DOUBLE,
+    FONT_FORMAT_RLE
+} font_format_t;
+
+/* RLE glyph: offset into the font data, width (0: no glyph) */
+typedef struct {
+    uint16_t offset;
+    uint8_t width;
+} font_glyph_t;
+
+typedef struct {
+    font_format_t format;
+    char first;                 // characters first-last have glyphs
+    char last;
+    uint8_t pages;
+    uint8_t spacing;            // blank columns after each glyph
+    uint8_t blank_width;        // width of ' ' and of characters without a glyph
+    const font_glyph_t *glyphs; // RLE fonts only
+    const uint8_t *data;
+} font_desc_t;
+
+/* Complete 6x8 font - ASCII 32 to 126 (95 characters) */
+const uint8_t font_6x8[FONT_6X8_GLYPHS][6] = {
+    /* ASCII 32 - 47 (Space, symbols) */
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // Space (32)
+    {0x00, 0x00, 0x5F, 0x00, 0x00, 0x00}, // !
+    {0x00, 0x07, 0x00, 0x07, 0x00, 0x00}, // "
+    {0x14, 0x7F, 0x14, 0x7F, 0x14, 0x00}, // #
+    {0x24, 0x2A, 0x7F, 0x2A, 0x12, 0x00}, // $
+    {0x23, 0x13, 0x08, 0x64, 0x62, 0x00}, // %
+    {0x36, 0x49, 0x55, 0x22, 0x50, 0x00}, // &
+    {0x00, 0x05, 0x03, 0x00, 0x00, 0x00}, // '
+    {0x00, 0x1C, 0x22, 0x41, 0x00, 0x00}, // (
+    {0x00, 0x41, 0x22, 0x1C, 0x00, 0x00}, // )
+    {0x14, 0x08, 0x3E, 0x08, 0x14, 0x00}, // *
+    {0x08, 0x08, 0x3E, 0x08, 0x08, 0x00}, // +
+    {0x00, 0x50, 0x30, 0x00, 0x00, 0x00}, // ,
+    {0x08, 0x08, 0x08, 0x08, 0x08, 0x00}, // -
+    {0x00, 0x60, 0x60, 0x00, 0x00, 0x00}, // .
+    {0x20, 0x10, 0x08, 0x04, 0x02, 0x00}, // /
+    
+    /* ASCII 48 - 57 (Numbers 0-9) */
+    {0x3E, 0x51, 0x49, 0x45, 0x3E, 0x00}, // 0
+    {0x00, 0x42, 0x7F, 0x40, 0x00, 0x00}, // 1
+    {0x42, 0x61, 0x51, 0x49, 0x46, 0x00}, // 2
+    {0x21, 0x41, 0x45, 0x4B, 0x31, 0x00}, // 3
+    {0x18, 0x14, 0x12, 0x7F, 0x10, 0x00}, // 4
+    {0x27, 0x45, 0x45, 0x45, 0x39, 0x00}, // 5
+    {0x3C, 0x4A, 0x49, 0x49, 0x30, 0x00}, // 6
+    {0x01, 0x71, 0x09, 0x05, 0x03, 0x00}, // 7
+    {0x36, 0x49, 0x49, 0x49, 0x36, 0x00}, // 8
+    {0x06, 0x49, 0x49, 0x29, 0x1E, 0x00}, // 9
+    
+    /* ASCII 58 - 64 (: ; < = > ? @) */
+    {0x00, 0x36, 0x36, 0x00, 0x00, 0x00}, // :
+    {0x00, 0x56, 0x36, 0x00, 0x00, 0x00}, // ;
+    {0x08, 0x14, 0x22, 0x41, 0x00, 0x00}, // <
+    {0x14, 0x14, 0x14, 0x14, 0x14, 0x00}, // =
+    {0x00, 0x41, 0x22, 0x14, 0x08, 0x00}, // >
+    {0x02, 0x01, 0x51, 0x09, 0x06, 0x00}, // ?
+    {0x32, 0x49, 0x79, 0x41, 0x3E, 0x00}, // @
+    
+    /* ASCII 65 - 90 (A-Z) */
+    {0x7E, 0x11, 0x11, 0x11, 0x7E, 0x00}, // A
+    {0x7F, 0x49, 0x49, 0x49, 0x36, 0x00}, // B
+    {0x3E, 0x41, 0x41, 0x41, 0x22, 0x00}, // C
+    {0x7F, 0x41, 0x41, 0x22, 0x1C, 0x00}, // D
+    {0x7F, 0x49, 0x49, 0x49, 0x41, 0x00}, // E
+    {0x7F, 0x09, 0x09, 0x09, 0x01, 0x00}, // F
+    {0x3E, 0x41, 0x49, 0x49, 0x7A, 0x00}, // G
+    {0x7F, 0x08, 0x08, 0x08, 0x7F, 0x00}, // H
+    {0x00, 0x41, 0x7F, 0x41, 0x00, 0x00}, // I
+    {0x20, 0x40, 0x41, 0x3F, 0x01, 0x00}, // J
+    {0x7F, 0x08, 0x14, 0x22, 0x41, 0x00}, // K
+    {0x7F, 0x40, 0x40, 0x40, 0x40, 0x00}, // L
+    {0x7F, 0x02, 0x0C, 0x02, 0x7F, 0x00}, // M
+    {0x7F, 0x04, 0x08, 0x10, 0x7F, 0x00}, // N
+    {0x3E, 0x41, 0x41, 0x41, 0x3E, 0x00}, // O
+    {0x7F, 0x09, 0x09, 0x09, 0x06, 0x00}, // P
+    {0x3E, 0x41, 0x51, 0x21, 0x5E, 0x00}, // Q
+    {0x7F, 0x09, 0x19, 0x29, 0x46, 0x00}, // R
+    {0x46, 0x49, 0x49, 0x49, 0x31, 0x00}, // S
+    {0x01, 0x01, 0x7F, 0x01, 0x01, 0x00}, // T
+    {0x3F, 0x40, 0x40, 0x40, 0x3F, 0x00}, // U
+    {0x1F, 0x20, 0x40, 0x20, 0x1F, 0x00}, // V
+    {0x3F, 0x40, 0x38, 0x40, 0x3F, 0x00}, // W
+    {0x63, 0x14, 0x08, 0x14, 0x63, 0x00}, // X
+    {0x07, 0x08, 0x70, 0x08, 0x07, 0x00}, // Y
+    {0x61, 0x51, 0x49, 0x45, 0x43, 0x00}, // Z
+    
+    /* ASCII 91 - 96 ([ \ ] ^ _ `) */
+    {0x00, 0x7F, 0x41, 0x41, 0x00, 0x00}, // [
+    {0x02, 0x04, 0x08, 0x10, 0x20, 0x00}, // backslash
+    {0x00, 0x41, 0x41, 0x7F, 0x00, 0x00}, // ]
+    {0x04, 0x02, 0x01, 0x02, 0x04, 0x00}, // ^
+    {0x40, 0x40, 0x40, 0x40, 0x40, 0x00}, // _
+    {0x00, 0x01, 0x02, 0x04, 0x00, 0x00}, // `
+    
+    /* ASCII 97 - 122 (a-z) */
+    {0x20, 0x54, 0x54, 0x54, 0x78, 0x00}, // a
+    {0x7F, 0x48, 0x44, 0x44, 0x38, 0x00}, // b
+    {0x38, 0x44, 0x44, 0x44, 0x20, 0x00}, // c
+    {0x38, 0x44, 0x44, 0x48, 0x7F, 0x00}, // d
+    {0x38, 0x54, 0x54, 0x54, 0x18, 0x00}, // e
+    {0x08, 0x7E, 0x09, 0x01, 0x02, 0x00}, // f
+    {0x0C, 0x52, 0x52, 0x52, 0x3E, 0x00}, // g
+    {0x7F, 0x08, 0x04, 0x04, 0x78, 0x00}, // h
+    {0x00, 0x44, 0x7D, 0x40, 0x00, 0x00}, // i
+    {0x20, 0x40, 0x44, 0x3D, 0x00, 0x00}, // j
+    {0x7F, 0x10, 0x28, 0x44, 0x00, 0x00}, // k
+    {0x00, 0x41, 0x7F, 0x40, 0x00, 0x00}, // l
+    {0x7C, 0x04, 0x18, 0x04, 0x78, 0x00}, // m
+    {0x7C, 0x08, 0x04, 0x04, 0x78, 0x00}, // n
+    {0x38, 0x44, 0x44, 0x44, 0x38, 0x00}, // o
+    {0x7C, 0x14, 0x14, 0x14, 0x08, 0x00}, // p
+    {0x08, 0x14, 0x14, 0x18, 0x7C, 0x00}, // q
+    {0x7C, 0x08, 0x04, 0x04, 0x08, 0x00}, // r
+    {0x48, 0x54, 0x54, 0x54, 0x20, 0x00}, // s
+    {0x04, 0x3F, 0x44, 0x40, 0x20, 0x00}, // t
+    {0x3C, 0x40, 0x40, 0x20, 0x7C, 0x00}, // u
+    {0x1C, 0x20, 0x40, 0x20, 0x1C, 0x00}, // v
+    {0x3C, 0x40, 0x30, 0x40, 0x3C, 0x00}, // w
+    {0x44, 0x28, 0x10, 0x28, 0x44, 0x00}, // x
+    {0x0C, 0x50, 0x50, 0x50, 0x3C, 0x00}, // y
+    {0x44, 0x64, 0x54, 0x4C, 0x44, 0x00}, // z
+    
+    /* ASCII 123 - 126 ({ | } ~) */
+    {0x00, 0x08, 0x36, 0x41, 0x00, 0x00}, // {
+    {0x00, 0x00, 0x7F, 0x00, 0x00, 0x00}, // |
+    {0x00, 0x41, 0x36, 0x08, 0x00, 0x00}, // }
+    {0x10, 0x08, 0x08, 0x10, 0x08, 0x00}, // ~
+};
+
+/* 480 bytes raw, 281 RLE-compressed (Host/font_gen.py) */
+static const uint8_t font_digits_rle[281] = {
+    0x8F, 0x00, 0x00, 0x08, 0x87, 0x1C, 0x00, 0x08, 0x8F, 0x00, // -
+    0x85, 0x00, 0x82, 0xE0, // .
+    0x02, 0xF0, 0xF8, 0xF2, 0x87, 0x07, 0x05, 0xF2, 0xF8, 0xF0, 0xC1, 0xE3, 0xC1, 0x87, 0x00, 0x05, 0xC1, 0xE3, 0xC1, 0x0F, 0x1F, 0x4F, 0x87, 0xE0, 0x02, 0x4F, 0x1F, 0x0F, // 0
+    0x8A, 0x00, 0x02, 0xF0, 0xF8, 0xF0, 0x8A, 0x00, 0x02, 0xC1, 0xE3, 0xC1, 0x8A, 0x00, 0x02, 0x0F, 0x1F, 0x0F, // 1
+    0x02, 0x00, 0x00, 0x02, 0x87, 0x07, 0x05, 0xF2, 0xF8, 0xF0, 0xC0, 0xE0, 0xC8, 0x87, 0x1C, 0x05, 0x09, 0x03, 0x01, 0x0F, 0x1F, 0x4F, 0x87, 0xE0, 0x02, 0x40, 0x00, 0x00, // 2
+    0x02, 0x00, 0x00, 0x02, 0x87, 0x07, 0x05, 0xF2, 0xF8, 0xF0, 0x00, 0x00, 0x08, 0x87, 0x1C, 0x05, 0xC9, 0xE3, 0xC1, 0x00, 0x00, 0x40, 0x87, 0xE0, 0x02, 0x4F, 0x1F, 0x0F, // 3
+    0x02, 0xF0, 0xF8, 0xF0, 0x87, 0x00, 0x05, 0xF0, 0xF8, 0xF0, 0x01, 0x03, 0x09, 0x87, 0x1C, 0x02, 0xC9, 0xE3, 0xC1, 0x8A, 0x00, 0x02, 0x0F, 0x1F, 0x0F, // 4
+    0x02, 0xF0, 0xF8, 0xF2, 0x87, 0x07, 0x05, 0x02, 0x00, 0x00, 0x01, 0x03, 0x09, 0x87, 0x1C, 0x05, 0xC8, 0xE0, 0xC0, 0x00, 0x00, 0x40, 0x87, 0xE0, 0x02, 0x4F, 0x1F, 0x0F, // 5
+    0x02, 0xF0, 0xF8, 0xF2, 0x87, 0x07, 0x05, 0x02, 0x00, 0x00, 0xC1, 0xE3, 0xC9, 0x87, 0x1C, 0x05, 0xC8, 0xE0, 0xC0, 0x0F, 0x1F, 0x4F, 0x87, 0xE0, 0x02, 0x4F, 0x1F, 0x0F, // 6
+    0x02, 0x00, 0x00, 0x02, 0x87, 0x07, 0x02, 0xF2, 0xF8, 0xF0, 0x8A, 0x00, 0x02, 0xC1, 0xE3, 0xC1, 0x8A, 0x00, 0x02, 0x0F, 0x1F, 0x0F, // 7
+    0x02, 0xF0, 0xF8, 0xF2, 0x87, 0x07, 0x05, 0xF2, 0xF8, 0xF0, 0xC1, 0xE3, 0xC9, 0x87, 0x1C, 0x05, 0xC9, 0xE3, 0xC1, 0x0F, 0x1F, 0x4F, 0x87, 0xE0, 0x02, 0x4F, 0x1F, 0x0F, // 8
+    0x02, 0xF0, 0xF8, 0xF2, 0x87, 0x07, 0x05, 0xF2, 0xF8, 0xF0, 0x01, 0x03, 0x09, 0x87, 0x1C, 0x05, 0xC9, 0xE3, 0xC1, 0x00, 0x00, 0x40, 0x87, 0xE0, 0x02, 0x4F, 0x1F, 0x0F, // 9
+    0x82, 0xC0, 0x82, 0x81, 0x82, 0x03, // :
+};
+
+static const font_glyph_t font_digits_glyphs[14] = {
+    {   0, 14 },  // -
+    {  10,  3 },  // .
+    {   0,  0 },  // / (no glyph)
+    {  14, 14 },  // 0
+    {  42, 14 },  // 1
+    {  60, 14 },  // 2
+    {  88, 14 },  // 3
+    { 116, 14 },  // 4
+    { 141, 14 },  // 5
+    { 169, 14 },  // 6
+    { 197, 14 },  // 7
+    { 219, 14 },  // 8
+    { 247, 14 },  // 9
+    { 275,  3 },  // :
+};
+
+static const font_desc_t fonts[FONT_COUNT] = {
+    [FONT_6X8]          = { FONT_FORMAT_FIXED,        ' ', '~', 1, 0,  6, NULL, &font_6x8[0][0] },
+    [FONT_6X8_PROP]     = { FONT_FORMAT_PROPORTIONAL, ' ', '~', 1, 1,  3, NULL, &font_6x8[0][0] },
+    [FONT_12X16]        = { FONT_FORMAT_DOUBLE,       ' ', '~', 2, 0, 12, NULL, &font_6x8[0][0] },
+    [FONT_DIGITS_14X24] = { FONT_FORMAT_RLE,          '-', ':', 3, 2, 14, font_digits_glyphs, font_digits_rle },
+};
+
+/* Nibble with every bit doubled (FONT_12X16) */
+static const uint8_t nibble_double[16] = {
+    0x00, 0x03, 0x0C, 0x0F, 0x30, 0x33, 0x3C, 0x3F,
+    0xC0, 0xC3, 0xCC, 0xCF, 0xF0, 0xF3, 0xFC, 0xFF
+};
+
+static const font_desc_t* font_desc(font_size_t font)
+{
+    return (font < FONT_COUNT) ? &fonts[font] : &fonts[FONT_6X8];
+}
+
+/**
+ * @brief Columns lead..lead+width-1 of a 6x8 glyph are not blank
+ * @retval false if the whole glyph is blank
+ */
+static bool trim_6x8(const uint8_t *columns, uint8_t *lead, uint8_t *width)
+{
+    int8_t first = -1;
+    int8_t last = -1;
+
+    for (int8_t i = 0; i < 6; i++) {
+        if (columns[i]) {
+            if (first < 0) {
+                first = i;
+            }
+            last = i;
+        }
+    }
+
+    if (first < 0) {
+        return false;
+    }
+
+    *lead = first;
+    *width = last - first + 1;
+    return true;
+}
+
+/**
+ * @brief Expand PackBits-style RLE into size bytes
+ *
+ * 0x00-0x7F: n + 1 literal bytes follow; 0x80-0xFF: the next byte
+ * repeated (n & 0x7F) + 1 times.
+ */
+static void rle_decode(const uint8_t *src, uint8_t *dst, uint16_t size)
+{
+    uint16_t out = 0;
+
+    while (out < size) {
+        uint8_t n = *src++;
+        uint8_t count = (n & 0x7F) + 1;
+
+        if (count > size - out) {
+            count = size - out;     // corrupt table: never write past dst
+        }
+
+        if (n & 0x80) {
+            for (uint8_t i = 0; i < count; i++) {
+                dst[out++] = *src;
+            }
+            src++;
+        } else {
+            for (uint8_t i = 0; i < count; i++) {
+                dst[out++] = *src++;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Get a glyph in page format
+ */
+void Font_GetGlyph(font_size_t font, char c, uint8_t *scratch, display_glyph_t *glyph)
+{
+    const font_desc_t *desc = font_desc(font);
+    const font_glyph_t *entry;
+    const uint8_t *columns;
+    uint8_t lead;
+
+    glyph->columns = NULL;
+    glyph->width = desc->blank_width;
+    glyph->advance = desc->blank_width + desc->spacing;
+    glyph->pages = desc->pages;
+
+    if (c < desc->first || c > desc->last) {
+        return;
+    }
+
+    columns = &desc->data[(c - desc->first) * 6];
+
+    switch (desc->format) {
+        case FONT_FORMAT_FIXED:
+            glyph->columns = columns;
+            break;
+
+        case FONT_FORMAT_PROPORTIONAL:
+            if (trim_6x8(columns, &lead, &glyph->width)) {
+                glyph->columns = columns + lead;
+                glyph->advance = glyph->width + desc->spacing;
+            }
+            break;
+
+        case FONT_FORMAT_DOUBLE:
+            for (uint8_t i = 0; i < 6; i++) {
+                uint8_t lo = nibble_double[columns[i] & 0x0F];
+                uint8_t hi = nibble_double[columns[i] >> 4];
+
+                scratch[2 * i] = scratch[2 * i + 1] = lo;
+                scratch[12 + 2 * i] = scratch[12 + 2 * i + 1] = hi;
+            }
+            glyph->columns = scratch;
+            break;
+
+        case FONT_FORMAT_RLE:
+            entry = &desc->glyphs[c - desc->first];
+            if (entry->width) {
+                rle_decode(&desc->data[entry->offset], scratch, entry->width * desc->pages);
+                glyph->columns = scratch;
+                glyph->width = entry->width;
+                glyph->advance = entry->width + desc->spacing;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Get the width and advance of a glyph without decoding it
+ */
+void Font_GetMetrics(font_size_t font, char c, uint8_t *width, uint8_t *advance)
+{
+    const font_desc_t *desc = font_desc(font);
+    uint8_t lead;
+
+    *width = desc->blank_width;
+
+    if (c >= desc->first && c <= desc->last) {
+        if (desc->format == FONT_FORMAT_RLE) {
+            if (desc->glyphs[c - desc->first].width) {
+                *width = desc->glyphs[c - desc->first].width;
+            }
+        } else if (desc->format == FONT_FORMAT_PROPORTIONAL) {
+            trim_6x8(&desc->data[(c - desc->first) * 6], &lead, width);
+        }
+    }
+
+    *advance = *width + desc->spacing;
+}
+
+/**
+ * @brief Get the height of a font in pages
+ */
+uint8_t Font_GetPages(font_size_t font)
+{
+    return font_desc(font)->pages;
+}
+
+/**
+ * @brief Get the table of a one-page fixed-cell font to index it directly
+ */
+const uint8_t *Font_GetFixedTable(font_size_t font, char *first, char *last, uint8_t *width)
+{
+    const font_desc_t *desc = font_desc(font);
+
+    if (desc->format != FONT_FORMAT_FIXED || desc->pages != 1) {
+        return NULL;
+    }
+
+    *first = desc->first;
+    *last = desc->last;
+    *width = desc->blank_width;     // cell width, no extra spacing
+    return desc->data;
+}
@@ -5,32 +5,72 @@
  ******************************************************************************
  */
 
+#include "main.h"
 #include "display_task.h"
 #include "display_driver.h"
+#include "display_bsp.h"
+#include "fingerprint_task.h"
 #include "FreeRTOS.h"
 #include "task.h"
 #include "queue.h"
 #include <string.h>
+#if DOOR_FLOAT_REFERENCE
 #include <math.h>
+#endif
 
 /* Private defines */
 #define DISPLAY_QUEUE_LENGTH    5
 #define DISPLAY_TASK_STACK      512
 #define DISPLAY_TASK_PRIORITY   (tskIDLE_PRIORITY + 1)
 
+/* Door animation geometry */
+#define DOOR_HINGE_X            20
+#define DOOR_HINGE_Y            15
+#define DOOR_WIDTH              30
+#define DOOR_HEIGHT             40
+#define DOOR_KNOB_LAST          19      // knob drawn while the angle is < 1.0 rad
+
+/* Door corners for one animation step (the two free corners share x) */
+typedef struct {
+    uint8_t x;
+    uint8_t y_top;
+    uint8_t y_bottom;
+} door_keyframe_t;
+
 /* Private variables */
 static QueueHandle_t displayQueue = NULL;
 static TaskHandle_t displayTaskHandle = NULL;
 static ui_state_t uiState = UI_STATE_IDLE;
-static float doorAngle = 0.0f;
-static const float doorStep = 0.05f;
-static uint8_t animationFrame = 0;
+static uint8_t door_step = 0;
 static DoorDirection_t door_direction =  DOOR_CLOSING;
+static uint8_t contrast = SSD1309_DEFAULT_CONTRAST;
+static door_keyframe_t door_keyframes[DOOR_KEYFRAMES];
+static display_render_stats_t render_stats;
+
+/*
+ * cos/sin of the door angle in Q14 for each step: 0.05 rad apart, the
+ * last one clamped to 1.57 rad (~90 degrees) like the old float loop.
+ */
+static const int16_t door_cos_q14[DOOR_KEYFRAMES] = {
+    16384, 16364, 16302, 16200, 16057, 15875, 15652, 15391, 15091, 14753, 14378,
+    13968, 13522, 13043, 12531, 11988, 11415, 10813, 10184,  9530,  8852,  8152,
+     7432,  6693,  5937,  5166,  4383,  3588,  2785,  1974,  1159,   341,    13,
+};
+
+static const int16_t door_sin_q14[DOOR_KEYFRAMES] = {
+        0,   819,  1636,  2448,  3255,  4053,  4842,  5618,  6380,  7126,  7855,
+     8564,  9251,  9915, 10555, 11168, 11753, 12309, 12834, 13327, 13787, 14212,
+    14602, 14955, 15271, 15548, 15787, 15986, 16146, 16265, 16343, 16380, 16384,
+};
 
 /* Private function prototypes */
 static void DisplayTask(void *argument);
 static void UI_DrawDoorAnimation(DoorDirection_t direction);
 static void UI_DrawIdleScreen(void);
+static void UI_DrawMessage(const char *line1, const char *line2);
+static const char *UI_EnrollErrorText(uint16_t error);
+static void UI_AppendNumber(char *buf, uint8_t size, uint16_t value);
+static void UI_BuildDoorKeyframes(void);
 
 /**
  * @brief Initialize display task
@@ -38,7 +78,7 @@ static void UI_DrawIdleScreen(void);
 void DisplayTask_Init(void)
 {
     /* Create queue */
-    displayQueue = xQueueCreate(DISPLAY_QUEUE_LENGTH, sizeof(display_event_t));
+    displayQueue = xQueueCreate(DISPLAY_QUEUE_LENGTH, sizeof(display_msg_t));
 
     if (displayQueue == NULL) {
         return;
@@ -65,8 +105,18 @@ void DisplayTask_Init(void)
  */
 void DisplayTask_Send(display_event_t event)
 {
+    DisplayTask_SendParam(event, 0);
+}
+
+/**
+ * @brief Send event with parameter to display task
+ */
+void DisplayTask_SendParam(display_event_t event, uint16_t param)
+{
+    display_msg_t msg = { .event = event, .param = param };
+
     if (displayQueue != NULL) {
-        xQueueSend(displayQueue, &event, 0);
+        xQueueSend(displayQueue, &msg, 0);
     }
 }
 
@@ -78,12 +128,43 @@ ui_state_t DisplayTask_GetState(void)
     return uiState;
 }
 
+/**
+ * @brief Change panel contrast (SPI is only touched from the display task)
+ */
+void DisplayTask_SetContrast(uint8_t value)
+{
+    contrast = value;
+    DisplayTask_SendParam(DISPLAY_EVENT_SET_CONTRAST, value);
+}
+
+/**
+ * @brief Get last requested contrast
+ */
+uint8_t DisplayTask_GetContrast(void)
+{
+    return contrast;
+}
+
+/**
+ * @brief Get door animation render timing
+ */
+display_render_stats_t DisplayTask_GetRenderStats(void)
+{
+    return render_stats;
+}
+
 /**
  * @brief Display task main function
  */
 static void DisplayTask(void *argument)
 {
-    display_event_t event;
+    display_msg_t msg;
+
+    /* Cycle counter for the render timing */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    UI_BuildDoorKeyframes();
 
     /* Initialize display driver (which initializes BSP) */
     Display_Init();
@@ -102,11 +183,13 @@ static void DisplayTask(void *argument)
     /* Main loop */
     for (;;)
     {
-        /* Check for events with timeout */
-        if (xQueueReceive(displayQueue, &event, pdMS_TO_TICKS(50)) == pdPASS)
+        /* Check for events; during the animation Display_Swap sets the pace */
+        TickType_t wait = (uiState == UI_STATE_DOOR_ANIMATION) ? 0 : pdMS_TO_TICKS(50);
+
+        if (xQueueReceive(displayQueue, &msg, wait) == pdPASS)
         {
             /* Process event */
-            switch (event)
+            switch (msg.event)
             {
                 case DISPLAY_EVENT_FINGER_OK:
                     Display_Clear();
@@ -129,15 +212,13 @@ static void DisplayTask(void *argument)
 
                 case DISPLAY_EVENT_DOOR_OPEN:
                     uiState = UI_STATE_DOOR_ANIMATION;
-                    doorAngle = 0.0f;
-                    animationFrame = 0;
+                    door_step = 0;
                     door_direction = DOOR_OPENING;
                     break;
 
                 case DISPLAY_EVENT_DOOR_CLOSED:
                     uiState = UI_STATE_DOOR_ANIMATION;
-                    doorAngle = 1.57f;   // puerta completamente abierta
-                    animationFrame = 0;
+                    door_step = DOOR_KEYFRAMES - 1;   // puerta completamente abierta
                     door_direction = DOOR_CLOSING;
                     break;
 
@@ -154,6 +235,46 @@ static void DisplayTask(void *argument)
                     uiState = UI_STATE_IDLE;
                     break;
 
+                case DISPLAY_EVENT_ENROLL_PLACE:
+                    UI_DrawMessage("Enroll:", "Place finger");
+                    uiState = UI_STATE_ENROLL;
+                    break;
+
+                case DISPLAY_EVENT_ENROLL_LIFT:
+                    UI_DrawMessage("Enroll:", "Lift finger");
+                    uiState = UI_STATE_ENROLL;
+                    break;
+
+                case DISPLAY_EVENT_ENROLL_PLACE_AGAIN:
+                    UI_DrawMessage("Enroll:", "Place again");
+                    uiState = UI_STATE_ENROLL;
+                    break;
+
+                case DISPLAY_EVENT_ENROLL_STORED:
+                {
+                    char line[20] = "Stored as ID ";
+
+                    UI_AppendNumber(line, sizeof(line), msg.param);
+                    UI_DrawMessage("Enroll OK", line);
+                    uiState = UI_STATE_ENROLL;
+                    vTaskDelay(pdMS_TO_TICKS(2000));
+                    UI_DrawIdleScreen();
+                    uiState = UI_STATE_IDLE;
+                    break;
+                }
+
+                case DISPLAY_EVENT_ENROLL_FAILED:
+                    UI_DrawMessage("Enroll failed", UI_EnrollErrorText(msg.param));
+                    uiState = UI_STATE_ENROLL;
+                    vTaskDelay(pdMS_TO_TICKS(2000));
+                    UI_DrawIdleScreen();
+                    uiState = UI_STATE_IDLE;
+                    break;
+
+                case DISPLAY_EVENT_SET_CONTRAST:
+                    Display_SetContrast((uint8_t)msg.param);
+                    break;
+
                 default:
                     break;
             }
@@ -174,66 +295,77 @@ static void DisplayTask(void *argument)
 
 
 
-static void UI_DrawDoorAnimation(DoorDirection_t direction)
+/**
+ * @brief Project the door corners for every animation step
+ *
+ * Rotation around the hinge (Y axis) plus the isometric projection
+ * (factor 0.5), done once in fixed point. The integer divisions truncate
+ * toward zero like the (int) casts of the float version.
+ */
+static void UI_BuildDoorKeyframes(void)
 {
-    const int hingeX = 20;
-    const int hingeY = 15;
-    const float doorWidth  = 30.0f;
-    const float doorHeight = 40.0f;
-    const float isoFactor = 0.5f;
-    const float maxAngle = 1.57f;  // ~90 grados
+    for (uint8_t i = 0; i < DOOR_KEYFRAMES; i++)
+    {
+        int32_t xr = DOOR_WIDTH * door_cos_q14[i];
+        int32_t zr = DOOR_WIDTH * door_sin_q14[i];
 
-    Display_Clear();
+        door_keyframes[i].x        = DOOR_HINGE_X + (xr - zr / 2) / 16384;
+        door_keyframes[i].y_top    = DOOR_HINGE_Y + (zr / 2) / 16384;
+        door_keyframes[i].y_bottom = DOOR_HINGE_Y + (DOOR_HEIGHT * 16384 + zr / 2) / 16384;
+    }
+}
 
-    float c = cosf(doorAngle);
-    float s = sinf(doorAngle);
+#if DOOR_FLOAT_REFERENCE
+/**
+ * @brief Per-frame float projection, kept only to compare render times
+ */
+static door_keyframe_t UI_DoorKeyframeFloat(uint8_t step)
+{
+    float angle = (step < DOOR_KEYFRAMES - 1) ? step * 0.05f : 1.57f;
+    float xr = DOOR_WIDTH * cosf(angle);
+    float zr = DOOR_WIDTH * sinf(angle);
+    door_keyframe_t kf = {
+        .x        = DOOR_HINGE_X + (int)(xr - zr * 0.5f),
+        .y_top    = DOOR_HINGE_Y + (int)(zr * 0.5f),
+        .y_bottom = DOOR_HINGE_Y + (int)(DOOR_HEIGHT + zr * 0.5f),
+    };
+
+    return kf;
+}
+#endif
 
-    /* Door 3D points (relative to hinge) */
+static void UI_DrawDoorAnimation(DoorDirection_t direction)
+{
+    uint32_t start = DWT->CYCCNT;
+    uint32_t us;
 
-    float x1 = doorWidth;
-    float x2 = doorWidth;
+#if DOOR_FLOAT_REFERENCE
+    door_keyframe_t frame = UI_DoorKeyframeFloat(door_step);
+    const door_keyframe_t *kf = &frame;
+#else
+    const door_keyframe_t *kf = &door_keyframes[door_step];
+#endif
 
+    Display_Clear();
 
     /* Draw frame (marco fijo) */
-    Display_DrawRect(hingeX - 2, hingeY - 2,
-                     doorWidth + 4, doorHeight + 4,
+    Display_DrawRect(DOOR_HINGE_X - 2, DOOR_HINGE_Y - 2,
+                     DOOR_WIDTH + 4, DOOR_HEIGHT + 4,
                      COLOR_WHITE);
 
-    /* Rotate around Y axis */
-    float xr1 = x1 * c;
-    float zr1 = x1 * s;
-    float xr2 = x2 * c;
-    float zr2 = x2 * s;
-
-    /* Project isometric */
-    int px0 = hingeX;
-    int py0 = hingeY;
-    int px1 = hingeX + (int)(xr1 - zr1 * isoFactor);
-    int py1 = hingeY + (int)(0 + zr1 * isoFactor);
-    int px2 = hingeX + (int)(xr2 - zr2 * isoFactor);
-    int py2 = hingeY + (int)(doorHeight + zr2 * isoFactor);
-    int px3 = hingeX;
-    int py3 = hingeY + (int)doorHeight;
-
-    if (doorAngle < 1.0f)
+    if (door_step <= DOOR_KNOB_LAST)
     {
-        Display_DrawCircle(px1 - 4,
-                           py1 + doorHeight / 2,
+        Display_DrawCircle(kf->x - 4,
+                           kf->y_top + DOOR_HEIGHT / 2,
                            2,
                            COLOR_WHITE);
     }
 
-    /* Draw door quad */
-    Display_DrawLine(px0, py0, px1, py1, COLOR_WHITE);
-    Display_DrawLine(px1, py1, px2, py2, COLOR_WHITE);
-    Display_DrawLine(px2, py2, px3, py3, COLOR_WHITE);
-    Display_DrawLine(px3, py3, px0, py0, COLOR_WHITE);
-
-    /* Draw inner depth edge */
-    if (doorAngle > 0.05f)
-    {
-        Display_DrawLine(px1, py1, px2, py2, COLOR_WHITE);
-    }
+    /* Draw door quad (hinge edge, top, free edge, bottom) */
+    Display_DrawLine(DOOR_HINGE_X, DOOR_HINGE_Y, kf->x, kf->y_top, COLOR_WHITE);
+    Display_DrawLine(kf->x, kf->y_top, kf->x, kf->y_bottom, COLOR_WHITE);
+    Display_DrawLine(kf->x, kf->y_bottom, DOOR_HINGE_X, DOOR_HINGE_Y + DOOR_HEIGHT, COLOR_WHITE);
+    Display_DrawLine(DOOR_HINGE_X, DOOR_HINGE_Y + DOOR_HEIGHT, DOOR_HINGE_X, DOOR_HINGE_Y, COLOR_WHITE);
 
     /* Display text based on direction */
     if (direction == DOOR_OPENING)
@@ -245,31 +377,42 @@ static void UI_DrawDoorAnimation(DoorDirection_t direction)
         Display_DrawString(60, 25, "Closing", FONT_6X8, COLOR_WHITE);
     }
 
-    Display_Update();
+    /* Render time: drawing only, the transfer runs in the background */
+    us = (DWT->CYCCNT - start) / (SystemCoreClock / 1000000);
+    render_stats.frames++;
+    render_stats.last_us = us;
+    if (us > render_stats.max_us)
+    {
+        render_stats.max_us = us;
+    }
+
+    Display_Swap();
 
-    /* Update angle based on direction */
+    /* Next keyframe based on direction */
     if (direction == DOOR_OPENING)
     {
-        doorAngle += doorStep;
-        if (doorAngle >= maxAngle)
+        if (door_step + 1 >= DOOR_KEYFRAMES)
         {
-            doorAngle = maxAngle;
             uiState = UI_STATE_IDLE;
             UI_DrawIdleScreen();
         }
+        else
+        {
+            door_step++;
+        }
     }
     else  // DOOR_CLOSING
     {
-        doorAngle -= doorStep;
-        if (doorAngle <= 0.0f)
+        if (door_step == 0)
         {
-            doorAngle = 0.0f;
             uiState = UI_STATE_IDLE;
             UI_DrawIdleScreen();
         }
+        else
+        {
+            door_step--;
+        }
     }
-
-    vTaskDelay(pdMS_TO_TICKS(30));
 }
 
 
@@ -354,3 +497,52 @@ static void UI_DrawIdleScreen(void)
 
     Display_Update();
 }
+
+/**
+ * @brief Draw a two-line message screen
+ */
+static void UI_DrawMessage(const char *line1, const char *line2)
+{
+    Display_Clear();
+    Display_DrawString(5, 20, line1, FONT_6X8, COLOR_WHITE);
+    Display_DrawString(5, 35, line2, FONT_6X8, COLOR_WHITE);
+    Display_Update();
+}
+
+/**
+ * @brief Human-readable enrollment failure reason
+ */
+static const char *UI_EnrollErrorText(uint16_t error)
+{
+    switch (error)
+    {
+        case FP_ENROLL_ERR_TIMEOUT:   return "Timeout";
+        case FP_ENROLL_ERR_CANCELLED: return "Cancelled";
+        case FP_ENROLL_ERR_SENSOR:    return "Sensor error";
+        case FP_ENROLL_ERR_IMAGE:     return "Bad image";
+        case FP_ENROLL_ERR_MISMATCH:  return "No match";
+        case FP_ENROLL_ERR_DB_FULL:   return "Memory full";
+        case FP_ENROLL_ERR_STORE:     return "Store error";
+        default:                      return "Error";
+    }
+}
+
+/**
+ * @brief Append a decimal number to a NUL-terminated string
+ */
+static void UI_AppendNumber(char *buf, uint8_t size, uint16_t value)
+{
+    char digits[5];
+    uint8_t n = 0;
+    uint8_t len = strlen(buf);
+
+    do {
+        digits[n++] = '0' + (value % 10);
+        value /= 10;
+    } while (value > 0);
+
+    while (n > 0 && len < size - 1) {
+        buf[len++] = digits[--n];
+    }
+    buf[len] = '\0';
+}
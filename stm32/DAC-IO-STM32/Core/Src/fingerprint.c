@@ -10,7 +10,11 @@
 #include <string.h>
 
 #define AS608_PKT_COMMAND  0x01
+#define AS608_PKT_DATA     0x02
 #define AS608_PKT_ACK      0x07
+#define AS608_PKT_END      0x08
+
+#define AS608_HDR_LEN      9   // start(2) + addr(4) + pid(1) + len(2)
 
 #define AS608_ACK_OK        0x00
 #define AS608_ACK_NOFINGER  0x02
@@ -152,7 +156,9 @@ static int as608_send_cmd(uint8_t instruction,
     tx[i++] = checksum >> 8;
     tx[i++] = checksum & 0xFF;
 
-    // TX / RX
+    // TX / RX (descartar restos de una respuesta anterior)
+    uart_bsp_flush();
+
     if (uart_bsp_tx(tx, i, AS608_TX_TIMEOUT_MS) != 0)
         return -1;
 
@@ -228,4 +234,53 @@ as608_status_t AS608_StoreChar(uint8_t buffer, uint16_t page_id)
     return as608_parse_ack(rx);
 }
 
+/*
+ * UpImage: tras el ACK el sensor envía la imagen en paquetes de datos
+ * (PID 0x02) terminados por un paquete final (PID 0x08). Solo se guarda
+ * un paquete cada vez; cada payload se entrega al callback.
+ */
+as608_status_t AS608_UpImage(as608_data_cb_t cb, void *ctx)
+{
+    uint8_t rx[12];
+    uint8_t pkt[AS608_HDR_LEN + AS608_DATA_PKT_MAX + 2];
+
+    if (as608_send_cmd(AS608_CMD_UP_IMAGE, NULL, 0, rx, sizeof(rx)) < 0)
+        return AS608_ERROR;
+
+    if (rx[9] != AS608_ACK_OK)
+        return as608_parse_ack(rx);
 
+    for (;;)
+    {
+        if (uart_bsp_rx(pkt, AS608_HDR_LEN, AS608_DATA_TIMEOUT_MS) != 0)
+            return AS608_ERROR;
+
+        uint8_t pid = pkt[6];
+        uint16_t length = (pkt[7] << 8) | pkt[8];
+
+        if (pkt[0] != 0xEF || pkt[1] != 0x01 ||
+            (pid != AS608_PKT_DATA && pid != AS608_PKT_END) ||
+            length < 2 || length > AS608_DATA_PKT_MAX + 2)
+            return AS608_ERROR;
+
+        if (uart_bsp_rx(&pkt[AS608_HDR_LEN], length, AS608_DATA_TIMEOUT_MS) != 0)
+            return AS608_ERROR;
+
+        // Checksum = PID + longitud + datos
+        uint16_t payload = length - 2;
+        uint16_t checksum = pid + pkt[7] + pkt[8];
+        for (uint16_t p = 0; p < payload; p++)
+            checksum += pkt[AS608_HDR_LEN + p];
+
+        uint16_t rx_sum = (pkt[AS608_HDR_LEN + payload] << 8) |
+                          pkt[AS608_HDR_LEN + payload + 1];
+        if (checksum != rx_sum)
+            return AS608_ERROR;
+
+        if (cb(&pkt[AS608_HDR_LEN], payload, ctx) < 0)
+            return AS608_ERROR;
+
+        if (pid == AS608_PKT_END)
+            return AS608_OK;
+    }
+}
@@ -9,6 +9,9 @@
 #include "fingerprint_task.h"
 #include "motor_task.h"
 #include "display_task.h"
+#include "can_task.h"
+#include "can_tp.h"
+#include "uart_bsp.h"
 typedef enum {
     FP_STATE_IDLE,
     FP_STATE_WAIT_FINGER,
@@ -28,16 +31,37 @@ typedef enum {
     ENROLL_GET_IMAGE_2,
     ENROLL_CONVERT_2,
     ENROLL_CREATE_MODEL,
-    ENROLL_STORE,
-    ENROLL_DONE,
-    ENROLL_FAIL
+    ENROLL_STORE
 } enroll_state_t;
 
+// Contexto del enrolamiento en curso (antes eran variables static locales)
+typedef struct {
+    enroll_state_t state;
+    uint16_t id;
+    TickType_t step_tick;   // inicio del paso actual, para el timeout
+} fp_enroll_t;
+
+// Bits de notificación de la tarea
+#define FP_NOTIFY_ENROLL   (1UL << 0)
+#define FP_NOTIFY_CANCEL   (1UL << 1)
+#define FP_NOTIFY_UPLOAD   (1UL << 2)
+
 
 static QueueHandle_t fp_queue;
 static TaskHandle_t fp_task_handle;
 static QueueHandle_t fp_confirm_queue;
 
+// Antirrebote: un dedo apoyado no genera más eventos hasta levantarlo
+// (NO_FINGER) o hasta que pase el intervalo de silencio desde el último evento
+static uint32_t fp_quiet_ms = FP_DUPLICATE_QUIET_MS;
+static uint8_t fp_armed = 1;
+static TickType_t fp_last_tick;
+static fingerprint_stats_t fp_stats;
+
+static fp_enroll_t enroll;
+static uint32_t fp_pending;
+static uint8_t fp_upload_on_reject = FP_IMAGE_UPLOAD_ON_REJECT;
+
 
 QueueHandle_t FingerprintTask_GetConfirmQueue(void)
 {
@@ -49,6 +73,248 @@ QueueHandle_t FingerprintTask_GetQueue(void)
     return fp_queue;
 }
 
+fingerprint_stats_t FingerprintTask_GetStats(void)
+{
+    fingerprint_stats_t stats = fp_stats;
+
+    stats.uart_overflows = uart_bsp_get_stats().rx_overflows;
+    return stats;
+}
+
+void FingerprintTask_SetQuietInterval(uint32_t quiet_ms)
+{
+    fp_quiet_ms = quiet_ms;
+}
+
+void FingerprintTask_SetImageUpload(uint8_t on_reject)
+{
+    fp_upload_on_reject = on_reject;
+}
+
+uint32_t FingerprintTask_GetQuietInterval(void)
+{
+    return fp_quiet_ms;
+}
+
+uint8_t FingerprintTask_GetImageUpload(void)
+{
+    return fp_upload_on_reject;
+}
+
+// Devuelve 0 si el evento se descarta
+static uint8_t fp_emit(as608_status_t status, uint16_t id)
+{
+    fingerprint_event_t evt = {
+        .kind = FP_EVT_AUTH,
+        .status = status,
+        .id = id
+    };
+    uint8_t sent;
+
+    // Si la RPi no confirma, CANTask deja de leer la cola: esperar un
+    // tiempo acotado y descartar para no parar el sensor
+    sent = xQueueSend(fp_queue, &evt, pdMS_TO_TICKS(FP_EVENT_SEND_MS)) == pdTRUE;
+    if (!sent)
+        fp_stats.events_dropped++;
+
+    fp_armed = 0;
+    fp_last_tick = xTaskGetTickCount();
+    return sent;
+}
+
+/*
+ * Espera hasta ms milisegundos o hasta que llegue una petición de
+ * enrolamiento/cancelación. Las peticiones quedan acumuladas en fp_pending.
+ */
+static void fp_wait(uint32_t ms)
+{
+    uint32_t bits = 0;
+
+    if (xTaskNotifyWait(0, FP_NOTIFY_ENROLL | FP_NOTIFY_CANCEL | FP_NOTIFY_UPLOAD,
+                        &bits, pdMS_TO_TICKS(ms)) == pdTRUE)
+    {
+        fp_pending |= bits;
+    }
+}
+
+static void fp_enroll_report(fp_enroll_step_t step, fp_enroll_error_t error)
+{
+    fingerprint_event_t evt = {
+        .kind = FP_EVT_ENROLL,
+        .status = (error == FP_ENROLL_ERR_NONE) ? AS608_OK : AS608_ERROR,
+        .id = enroll.id,
+        .step = step,
+        .error = error
+    };
+
+    xQueueSend(fp_queue, &evt, 0);
+
+    switch (step)
+    {
+    case FP_ENROLL_PLACE_FINGER:
+        DisplayTask_SendParam(DISPLAY_EVENT_ENROLL_PLACE, 0);
+        break;
+    case FP_ENROLL_LIFT:
+        DisplayTask_SendParam(DISPLAY_EVENT_ENROLL_LIFT, 0);
+        break;
+    case FP_ENROLL_PLACE_AGAIN:
+        DisplayTask_SendParam(DISPLAY_EVENT_ENROLL_PLACE_AGAIN, 0);
+        break;
+    case FP_ENROLL_STORED:
+        DisplayTask_SendParam(DISPLAY_EVENT_ENROLL_STORED, enroll.id);
+        break;
+    case FP_ENROLL_FAILED:
+    default:
+        DisplayTask_SendParam(DISPLAY_EVENT_ENROLL_FAILED, error);
+        break;
+    }
+}
+
+static void fp_enroll_goto(enroll_state_t next, fp_enroll_step_t step)
+{
+    enroll.state = next;
+    enroll.step_tick = xTaskGetTickCount();
+    fp_enroll_report(step, FP_ENROLL_ERR_NONE);
+}
+
+static fp_state_t fp_enroll_fail(fp_enroll_error_t error)
+{
+    fp_enroll_report(FP_ENROLL_FAILED, error);
+    return FP_STATE_IDLE;
+}
+
+static int fp_image_chunk(const uint8_t *data, uint16_t len, void *ctx)
+{
+    return (CAN_TP_StreamWrite((can_tp_tx_t *)ctx, data, len) == CAN_TP_OK) ? 0 : -1;
+}
+
+/*
+ * Sube la última imagen capturada (ImageBuffer del AS608) a la RPi por
+ * ISO-TP. La imagen pasa paquete a paquete del UART al CAN sin guardarse
+ * entera en RAM. Al terminar se informa del resultado y de los bytes/s.
+ */
+static void fp_upload_image(void)
+{
+    can_tp_tx_t tx;
+    as608_status_t st;
+    uint8_t info[8];
+
+    CAN_TP_StreamBegin(&tx, CAN_ID_TP_IMAGE, AS608_IMAGE_SIZE);
+    st = AS608_UpImage(fp_image_chunk, &tx);
+
+    // StreamEnd cierra la sesión también si la subida se cortó a medias
+    if (CAN_TP_StreamEnd(&tx) != CAN_TP_OK)
+        st = AS608_ERROR;
+
+    uint32_t elapsed_ms = (xTaskGetTickCount() - tx.start) * portTICK_PERIOD_MS;
+    uint32_t bps = (elapsed_ms > 0) ? (tx.queued * 1000UL) / elapsed_ms : 0;
+
+    if (st == AS608_OK)
+    {
+        fp_stats.image_uploads++;
+        fp_stats.image_bytes_per_s = bps;
+    }
+    else
+    {
+        fp_stats.image_errors++;
+    }
+
+    // [resultado, bytes (24 bits), ms (16 bits), bytes/s (16 bits)]
+    info[0] = (st == AS608_OK) ? 0 : 1;
+    info[1] = tx.queued & 0xFF;
+    info[2] = (tx.queued >> 8) & 0xFF;
+    info[3] = (tx.queued >> 16) & 0xFF;
+    info[4] = elapsed_ms & 0xFF;
+    info[5] = (elapsed_ms >> 8) & 0xFF;
+    info[6] = bps & 0xFF;
+    info[7] = (bps >> 8) & 0xFF;
+    CAN_BSP_Send(CAN_ID_FP_IMAGE_INFO, info, sizeof(info));
+}
+
+/*
+ * Un paso del enrolamiento. Devuelve FP_STATE_ENROLL mientras sigue en curso.
+ * Cada fallo se notifica con su motivo a la pantalla y por CAN.
+ */
+static fp_state_t fp_enroll_run(void)
+{
+    as608_status_t st;
+
+    // Cancelación desde la RPi; una nueva petición de enrolar se ignora
+    if (fp_pending & FP_NOTIFY_CANCEL)
+    {
+        fp_pending = 0;
+        return fp_enroll_fail(FP_ENROLL_ERR_CANCELLED);
+    }
+    fp_pending &= ~FP_NOTIFY_ENROLL;
+
+    if ((xTaskGetTickCount() - enroll.step_tick) >= pdMS_TO_TICKS(FP_ENROLL_STEP_TIMEOUT_MS))
+        return fp_enroll_fail(FP_ENROLL_ERR_TIMEOUT);
+
+    switch (enroll.state)
+    {
+    case ENROLL_GET_IMAGE_1:
+    case ENROLL_GET_IMAGE_2:
+        st = AS608_GetImage();
+        if (st == AS608_OK)
+            enroll.state = (enroll.state == ENROLL_GET_IMAGE_1) ? ENROLL_CONVERT_1
+                                                                : ENROLL_CONVERT_2;
+        else if (st == AS608_NO_FINGER)
+            fp_wait(FP_ENROLL_POLL_MS);
+        else
+            return fp_enroll_fail(FP_ENROLL_ERR_SENSOR);
+        break;
+
+    case ENROLL_CONVERT_1:
+        if (AS608_Img2Tz(1) != AS608_OK)
+            return fp_enroll_fail(FP_ENROLL_ERR_IMAGE);
+        fp_enroll_goto(ENROLL_WAIT_RELEASE, FP_ENROLL_LIFT);
+        break;
+
+    case ENROLL_WAIT_RELEASE:
+        st = AS608_GetImage();
+        if (st == AS608_NO_FINGER)
+            fp_enroll_goto(ENROLL_GET_IMAGE_2, FP_ENROLL_PLACE_AGAIN);
+        else if (st == AS608_OK)
+            fp_wait(FP_ENROLL_POLL_MS);
+        else
+            return fp_enroll_fail(FP_ENROLL_ERR_SENSOR);
+        break;
+
+    case ENROLL_CONVERT_2:
+        if (AS608_Img2Tz(2) != AS608_OK)
+            return fp_enroll_fail(FP_ENROLL_ERR_IMAGE);
+        enroll.state = ENROLL_CREATE_MODEL;
+        break;
+
+    case ENROLL_CREATE_MODEL:
+        if (AS608_RegModel() != AS608_OK)
+            return fp_enroll_fail(FP_ENROLL_ERR_MISMATCH);
+
+        enroll.id = AS608_FindFreeID(300);
+        if (enroll.id == 0xFFFF)
+            return fp_enroll_fail(FP_ENROLL_ERR_DB_FULL);
+
+        enroll.state = ENROLL_STORE;
+        break;
+
+    case ENROLL_STORE:
+        if (AS608_StoreChar(1, enroll.id) != AS608_OK)
+            return fp_enroll_fail(FP_ENROLL_ERR_STORE);
+
+        fp_enroll_report(FP_ENROLL_STORED, FP_ENROLL_ERR_NONE);
+
+        // El dedo sigue apoyado: que no se reconozca como acceso al salir
+        fp_armed = 0;
+        fp_last_tick = xTaskGetTickCount();
+        return FP_STATE_IDLE;
+
+    default:
+        return fp_enroll_fail(FP_ENROLL_ERR_SENSOR);
+    }
+
+    return FP_STATE_ENROLL;
+}
+
 static void FingerprintTask(void *arg)
 {
     fp_state_t state = FP_STATE_IDLE;
@@ -59,25 +325,51 @@ static void FingerprintTask(void *arg)
         switch (state)
         {
         case FP_STATE_IDLE:
-        	door_state = MotorTask_GetDoorStatus();
             state = FP_STATE_WAIT_FINGER;
 
 
             break;
 
         case FP_STATE_WAIT_FINGER:
-            if (enroll_requested)
+            if (fp_pending & FP_NOTIFY_ENROLL)
             {
-                enroll_requested = 0;
+                fp_pending = 0;
+                enroll.id = 0xFFFF;
+                fp_enroll_goto(ENROLL_GET_IMAGE_1, FP_ENROLL_PLACE_FINGER);
                 state = FP_STATE_ENROLL;
             }
+            else if (fp_pending & FP_NOTIFY_UPLOAD)
+            {
+                fp_pending &= ~FP_NOTIFY_UPLOAD;
+                fp_upload_image();
+            }
             else
             {
+                as608_status_t img = AS608_GetImage();
 
-                if (AS608_GetImage() == AS608_OK)
-                    state = FP_STATE_CONVERT;
+                if (img == AS608_OK)
+                {
+                    fp_stats.scans++;
+
+                    // Mismo dedo todavía apoyado: no repetir Img2Tz/Search
+                    if (!fp_armed &&
+                        (xTaskGetTickCount() - fp_last_tick) < pdMS_TO_TICKS(fp_quiet_ms))
+                    {
+                        fp_stats.duplicates_suppressed++;
+                        fp_wait(FP_LIFT_POLL_MS);
+                    }
+                    else
+                    {
+                        state = FP_STATE_CONVERT;
+                    }
+                }
                 else
-                    vTaskDelay(pdMS_TO_TICKS(5000));
+                {
+                    if (img == AS608_NO_FINGER)
+                        fp_armed = 1;
+
+                    fp_wait(FP_IDLE_POLL_MS);
+                }
             }
 
             break;
@@ -98,11 +390,14 @@ static void FingerprintTask(void *arg)
 
         case FP_STATE_MATCH:
         {
-            fingerprint_event_t evt = {
-                .status = AS608_MATCH,
-                .id = id
-            };
-            xQueueSend(fp_queue, &evt, 0);
+            fp_stats.matches++;
+            if (!fp_emit(AS608_MATCH, id))
+            {
+                // La RPi no va a ver el acceso: no esperar su confirmación
+                DisplayTask_Send(DISPLAY_EVENT_FINGER_FAIL);
+                state = FP_STATE_IDLE;
+                break;
+            }
             vTaskDelay(pdMS_TO_TICKS(500));
             DisplayTask_Send(DISPLAY_EVENT_FINGER_OK);
             state = FP_STATE_WAIT_CONFIRM;
@@ -135,110 +430,29 @@ static void FingerprintTask(void *arg)
                 }
             }
 
+            // El intervalo de silencio cuenta desde el final de la espera
+            fp_last_tick = xTaskGetTickCount();
             state = FP_STATE_IDLE;
             break;
         }
 
         case FP_STATE_NO_MATCH: {
-            fingerprint_event_t evt = {
-                .status = AS608_NO_MATCH,
-                .id = 0
-            };
+            fp_stats.rejections++;
             DisplayTask_Send(DISPLAY_EVENT_FINGER_FAIL);
-            xQueueSend(fp_queue, &evt, 0);
+            fp_emit(AS608_NO_MATCH, 0);
             vTaskDelay(pdMS_TO_TICKS(500));
+
+            // Rechazo: enviar la captura a la RPi para poder revisarla
+            if (fp_upload_on_reject)
+                fp_upload_image();
+
             state = FP_STATE_IDLE;
             break;
         }
 
         case FP_STATE_ENROLL:
-        {
-            static enroll_state_t enroll_state = ENROLL_GET_IMAGE_1;
-            static uint16_t enroll_id = 0xFFFF;
-
-            switch (enroll_state)
-            {
-            case ENROLL_GET_IMAGE_1:
-                if (AS608_GetImage() == AS608_OK)
-                    enroll_state = ENROLL_CONVERT_1;
-                else
-                    vTaskDelay(pdMS_TO_TICKS(5000));
-                break;
-
-            case ENROLL_CONVERT_1:
-                if (AS608_Img2Tz(1) == AS608_OK)
-                    enroll_state = ENROLL_WAIT_RELEASE;
-                else
-                    enroll_state = ENROLL_FAIL;
-                break;
-
-            case ENROLL_WAIT_RELEASE:
-                if (AS608_GetImage() == AS608_NO_FINGER)
-                    enroll_state = ENROLL_GET_IMAGE_2;
-                else
-                    vTaskDelay(pdMS_TO_TICKS(5000));
-                break;
-
-            case ENROLL_GET_IMAGE_2:
-                if (AS608_GetImage() == AS608_OK)
-                    enroll_state = ENROLL_CONVERT_2;
-                else
-                    vTaskDelay(pdMS_TO_TICKS(5000));
-                break;
-
-            case ENROLL_CONVERT_2:
-                if (AS608_Img2Tz(2) == AS608_OK)
-                    enroll_state = ENROLL_CREATE_MODEL;
-                else
-                    enroll_state = ENROLL_FAIL;
-                break;
-
-            case ENROLL_CREATE_MODEL:
-                if (AS608_RegModel() == AS608_OK)
-                {
-                    enroll_id = AS608_FindFreeID(300);
-                    if (enroll_id != 0xFFFF)
-                        enroll_state = ENROLL_STORE;
-                    else
-                        enroll_state = ENROLL_FAIL;
-                }
-                else
-                    enroll_state = ENROLL_FAIL;
-                break;
-
-            case ENROLL_STORE:
-                if (AS608_StoreChar(1, enroll_id) == AS608_OK)
-                    enroll_state = ENROLL_DONE;
-                else
-                    enroll_state = ENROLL_FAIL;
-                break;
-
-            case ENROLL_DONE:
-            {
-                fingerprint_event_t evt = {
-                    .status = AS608_OK,
-                    .id = enroll_id
-                };
-                xQueueSend(fp_queue, &evt, 0);
-
-
-                enroll_state = ENROLL_GET_IMAGE_1;
-                state = FP_STATE_IDLE;
-                break;
-            }
-
-            case ENROLL_FAIL:
-            default:
-
-                enroll_state = ENROLL_GET_IMAGE_1;
-                state = FP_STATE_ERROR;
-                break;
-            }
-
+            state = fp_enroll_run();
             break;
-        }
-
-
 
         case FP_STATE_ERROR:
         default:
@@ -251,6 +465,12 @@ static void FingerprintTask(void *arg)
 
 void FingerprintTask_Init(void)
 {
+    // Recepción UART por interrupción (el sensor responde por USART2)
+    uart_bsp_init();
+
+    // Canal ISO-TP de la imagen: los FC de la RPi llegan por CAN_ID_TP_IMAGE_FC
+    CAN_TP_Bind(CAN_ID_TP_IMAGE_FC, CAN_ID_TP_IMAGE, NULL, NULL);
+
     // Crear la cola de eventos de fingerprint
     fp_queue = xQueueCreate(4, sizeof(fingerprint_event_t));
 
@@ -277,5 +497,29 @@ void FingerprintTask_Init(void)
 
 void Fingerprint_RequestEnroll(void)
 {
-    enroll_requested = 1;
+    if (fp_task_handle != NULL)
+        xTaskNotify(fp_task_handle, FP_NOTIFY_ENROLL, eSetBits);
+}
+
+void Fingerprint_RequestEnrollFromISR(void)
+{
+    BaseType_t hpw = pdFALSE;
+
+    if (fp_task_handle != NULL)
+    {
+        xTaskNotifyFromISR(fp_task_handle, FP_NOTIFY_ENROLL, eSetBits, &hpw);
+        portYIELD_FROM_ISR(hpw);
+    }
+}
+
+void Fingerprint_CancelEnroll(void)
+{
+    if (fp_task_handle != NULL)
+        xTaskNotify(fp_task_handle, FP_NOTIFY_CANCEL, eSetBits);
+}
+
+void Fingerprint_RequestImageUpload(void)
+{
+    if (fp_task_handle != NULL)
+        xTaskNotify(fp_task_handle, FP_NOTIFY_UPLOAD, eSetBits);
 }
@@ -0,0 +1,66 @@
+/*
+ * fw_image.c
+ *
+ *  Comprobaciones de la imagen en staging, comunes a la aplicación y al
+ *  cargador (ver fw_image.h). Solo C y accesos a memoria: nada de HAL.
+ */
+
+#include "fw_image.h"
+#include <stddef.h>
+
+/* CRC-32 con tabla de 16 entradas: 64 bytes de flash */
+static const uint32_t fw_crc_table[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+
+uint32_t FW_Image_Crc32(uint32_t crc, const uint8_t *data, uint32_t len)
+{
+    crc = ~crc;
+    while (len--)
+    {
+        crc ^= *data++;
+        crc = (crc >> 4) ^ fw_crc_table[crc & 0x0F];
+        crc = (crc >> 4) ^ fw_crc_table[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+/*
+ * El CRC solo dice que llegó lo que se envió. Antes de borrar la
+ * aplicación se comprueba que la imagen es una aplicación para esta
+ * dirección: un .elf/.hex enviado por error o un binario enlazado en otra
+ * dirección (p. ej. en 0x08000000, sin cargador) no pasa.
+ */
+uint8_t FW_Image_VectorsValid(const uint32_t *vectors, uint32_t size)
+{
+    uint32_t sp = vectors[0];
+    uint32_t reset = vectors[1];
+
+    if (sp <= FW_SRAM_BASE || sp > FW_SRAM_END || (sp & 3))
+        return 0;
+
+    if (!(reset & 1) || (reset & ~1UL) < FW_APP_BASE || (reset & ~1UL) >= FW_APP_BASE + size)
+        return 0;
+
+    return 1;
+}
+
+const fw_header_t *FW_Image_StageValid(void)
+{
+    const fw_header_t *hdr = (const fw_header_t *)FW_HEADER_ADDR;
+
+    if (hdr->magic != FW_HEADER_MAGIC || hdr->check != ~FW_HEADER_MAGIC ||
+        hdr->size == 0 || hdr->size > FW_MAX_IMAGE)
+        return NULL;
+
+    if (FW_Image_Crc32(0, (const uint8_t *)FW_STAGE_BASE, hdr->size) != hdr->crc)
+        return NULL;
+
+    if (!FW_Image_VectorsValid((const uint32_t *)FW_STAGE_BASE, hdr->size))
+        return NULL;
+
+    return hdr;
+}
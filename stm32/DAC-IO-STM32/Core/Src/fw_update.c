@@ -0,0 +1,403 @@
+/*
+ * fw_update.c
+ *
+ *  Recepción de firmware por ISO-TP y programación de la zona de staging
+ *  en paralelo con la recepción (ver fw_update.h).
+ */
+
+#include "fw_update.h"
+#include "can_task.h"
+#include "can_tp.h"
+#include "motor_task.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include <stddef.h>
+
+typedef enum {
+    FW_IDLE,
+    FW_RECEIVING,       // staging borrado, llegando bloques
+    FW_COMMITTED        // imagen completa, CRC correcto y cabecera escrita
+} fw_state_t;
+
+/* Trabajo para la tarea FWUPD: un bloque recibido o una orden de control */
+typedef struct {
+    uint8_t  cmd;       // FW_CMD_* o 0 para un bloque
+    uint8_t *block;     // bloque del pool ISO-TP, se libera tras programarlo
+    uint32_t len;
+    uint32_t arg0;
+    uint32_t arg1;
+} fw_job_t;
+
+static QueueHandle_t     fw_queue;
+static volatile uint8_t  fw_in_flight;
+static fw_state_t        fw_state;
+static uint32_t          fw_size;
+static uint32_t          fw_crc;
+static TickType_t        fw_start;
+static fw_update_stats_t fw_stats;
+
+static inline uint32_t fw_get32(const uint8_t *p)
+{
+    return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void fw_status(uint8_t cmd, uint8_t status, uint32_t value)
+{
+    uint8_t data[6];
+
+    data[0] = cmd;
+    data[1] = status;
+    data[2] = value & 0xFF;
+    data[3] = (value >> 8) & 0xFF;
+    data[4] = (value >> 16) & 0xFF;
+    data[5] = value >> 24;
+    CAN_BSP_Send(CAN_ID_FW_STATUS, data, sizeof(data));
+}
+
+/* ---------------------------------------------------------------------- */
+/* Flash                                                                   */
+/* ---------------------------------------------------------------------- */
+
+// Borra los sectores del staging. La CPU queda parada mientras dura
+static uint8_t fw_erase_stage(void)
+{
+    FLASH_EraseInitTypeDef erase = {
+        .TypeErase    = FLASH_TYPEERASE_SECTORS,
+        .Sector       = FW_STAGE_FIRST_SECTOR,
+        .NbSectors    = FW_STAGE_SECTORS,
+        .VoltageRange = FLASH_VOLTAGE_RANGE_3,
+    };
+    uint32_t sector_error;
+    HAL_StatusTypeDef ret;
+
+    HAL_FLASH_Unlock();
+    ret = HAL_FLASHEx_Erase(&erase, &sector_error);
+    HAL_FLASH_Lock();
+
+    return ret == HAL_OK ? FW_OK : FW_ERR_FLASH;
+}
+
+/*
+ * Programa palabra a palabra y relee. Una palabra que ya tiene el valor
+ * (bloque repetido porque se perdió el BLOCK_OK) no se vuelve a escribir;
+ * una que no está borrada y no coincide es un error.
+ */
+static uint8_t fw_program(uint32_t addr, const uint8_t *data, uint32_t len)
+{
+    uint8_t status = FW_OK;
+
+    HAL_FLASH_Unlock();
+
+    for (uint32_t i = 0; i < len; i += 4)
+    {
+        volatile uint32_t *dst = (volatile uint32_t *)(addr + i);
+        uint32_t word = 0xFFFFFFFF;
+
+        // Última palabra incompleta: el resto queda como borrado
+        for (uint32_t b = 0; b < 4 && i + b < len; b++)
+            word = (word & ~(0xFFUL << (8 * b))) | ((uint32_t)data[i + b] << (8 * b));
+
+        if (*dst == word)
+            continue;
+
+        if (*dst != 0xFFFFFFFF ||
+            HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, addr + i, word) != HAL_OK ||
+            *dst != word)
+        {
+            status = FW_ERR_FLASH;
+            break;
+        }
+    }
+
+    HAL_FLASH_Lock();
+    return status;
+}
+
+/*
+ * Borrar el staging para la CPU y las ISR varios segundos y ACTIVATE
+ * reinicia: ninguna de las dos se acepta con la puerta abierta o en
+ * movimiento (la parada de emergencia no se atendería).
+ */
+static uint8_t fw_door_idle(void)
+{
+    Door_Status_t door = MotorTask_GetDoorStatus();
+
+    return door.state == DOOR_STATE_CLOSED && !door.is_moving;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Tarea                                                                   */
+/* ---------------------------------------------------------------------- */
+
+static void fw_handle_block(fw_job_t *job)
+{
+    uint32_t offset = fw_get32(job->block);
+    uint32_t crc = fw_get32(job->block + 4);
+    const uint8_t *data = job->block + FW_BLOCK_HDR;
+    uint32_t len = job->len - FW_BLOCK_HDR;
+    uint8_t status;
+
+    if (fw_state != FW_RECEIVING)
+        status = FW_ERR_STATE;
+    else if ((offset & 3) || offset + len > fw_size)
+        status = FW_ERR_RANGE;
+    else if (FW_Image_Crc32(0, data, len) != crc)
+        status = FW_ERR_CRC;
+    else
+        status = fw_program(FW_STAGE_BASE + offset, data, len);
+
+    CAN_TP_Release(job->block);
+    taskENTER_CRITICAL();
+    fw_in_flight--;
+    taskEXIT_CRITICAL();
+
+    if (status == FW_OK)
+    {
+        fw_stats.blocks++;
+        fw_status(FW_EVT_BLOCK_OK, FW_OK, offset);
+    }
+    else
+    {
+        fw_stats.block_errors++;
+        fw_status(FW_EVT_BLOCK_ERR, status, offset);
+    }
+}
+
+static void fw_handle_command(fw_job_t *job)
+{
+    switch (job->cmd)
+    {
+    case FW_CMD_BEGIN:
+    {
+        uint8_t status;
+
+        if (!fw_door_idle())
+        {
+            fw_status(FW_CMD_BEGIN, FW_ERR_STATE, 0);
+            break;
+        }
+
+        if (job->arg0 == 0 || job->arg0 > FW_MAX_IMAGE)
+        {
+            fw_status(FW_CMD_BEGIN, FW_ERR_SIZE, job->arg0);
+            break;
+        }
+
+        // Todo el borrado antes de READY: la RPi no envía bloques mientras
+        fw_state = FW_IDLE;
+        status = fw_erase_stage();
+        if (status == FW_OK)
+        {
+            fw_size = job->arg0;
+            fw_crc = job->arg1;
+            fw_start = xTaskGetTickCount();
+            fw_state = FW_RECEIVING;
+        }
+        fw_status(FW_EVT_READY, status, FW_BLOCK_DATA);
+        break;
+    }
+
+    case FW_CMD_COMMIT:
+    {
+        // activate e installed quedan borradas: las escriben ACTIVATE y el cargador
+        fw_header_t hdr = {
+            .magic = FW_HEADER_MAGIC,
+            .size  = fw_size,
+            .crc   = fw_crc,
+            .check = ~FW_HEADER_MAGIC,
+        };
+        uint32_t crc;
+        uint32_t ms;
+
+        if (fw_state != FW_RECEIVING)
+        {
+            fw_status(FW_CMD_COMMIT, FW_ERR_STATE, 0);
+            break;
+        }
+
+        crc = FW_Image_Crc32(0, (const uint8_t *)FW_STAGE_BASE, fw_size);
+        if (crc != fw_crc)
+        {
+            fw_status(FW_CMD_COMMIT, FW_ERR_CRC, crc);
+            break;
+        }
+
+        if (!FW_Image_VectorsValid((const uint32_t *)FW_STAGE_BASE, fw_size))
+        {
+            fw_status(FW_CMD_COMMIT, FW_ERR_IMAGE, *(const uint32_t *)(FW_STAGE_BASE + 4));
+            break;
+        }
+
+        if (fw_program(FW_HEADER_ADDR, (const uint8_t *)&hdr, offsetof(fw_header_t, activate)) != FW_OK)
+        {
+            fw_status(FW_CMD_COMMIT, FW_ERR_FLASH, 0);
+            break;
+        }
+
+        ms = (xTaskGetTickCount() - fw_start) * portTICK_PERIOD_MS;
+        fw_stats.images++;
+        fw_stats.last_bytes_per_s = ms ? fw_size * 1000 / ms : fw_size;
+        fw_state = FW_COMMITTED;
+        fw_status(FW_CMD_COMMIT, FW_OK, crc);
+        break;
+    }
+
+    case FW_CMD_ABORT:
+        fw_state = FW_IDLE;
+        fw_status(FW_CMD_ABORT, FW_OK, 0);
+        break;
+
+    case FW_CMD_ACTIVATE:
+    {
+        // La cabecera se vuelve a comprobar: puede venir de una sesión anterior
+        const fw_header_t *hdr = FW_Image_StageValid();
+        uint32_t activate = FW_ACTIVATE_MAGIC;
+
+        if (fw_state == FW_RECEIVING || !fw_door_idle())
+        {
+            fw_status(FW_CMD_ACTIVATE, FW_ERR_STATE, 0);
+            break;
+        }
+
+        if (hdr == NULL)
+        {
+            // Sin COMMIT: fuera de secuencia; con COMMIT: imagen que no arrancaría
+            fw_status(FW_CMD_ACTIVATE,
+                      ((const fw_header_t *)FW_HEADER_ADDR)->magic == FW_HEADER_MAGIC ? FW_ERR_IMAGE : FW_ERR_STATE,
+                      *(const uint32_t *)(FW_STAGE_BASE + 4));
+            break;
+        }
+
+        if (hdr->installed != FW_WORD_ERASED)
+        {
+            fw_status(FW_CMD_ACTIVATE, FW_ERR_INSTALLED, hdr->size);
+            break;
+        }
+
+        // La copia la hace el cargador al arrancar (ver fw_image.h)
+        if (fw_program(FW_HEADER_ADDR + offsetof(fw_header_t, activate), (const uint8_t *)&activate, sizeof(activate)) != FW_OK)
+        {
+            fw_status(FW_CMD_ACTIVATE, FW_ERR_FLASH, 0);
+            break;
+        }
+
+        fw_status(FW_CMD_ACTIVATE, FW_OK, hdr->size);
+        vTaskDelay(pdMS_TO_TICKS(20));      // que salga la respuesta
+
+        NVIC_SystemReset();
+        break;
+    }
+    }
+}
+
+static void FW_UpdateTask(void *argument)
+{
+    fw_job_t job;
+
+    for (;;)
+    {
+        xQueueReceive(fw_queue, &job, portMAX_DELAY);
+
+        if (job.cmd == 0)
+            fw_handle_block(&job);
+        else
+            fw_handle_command(&job);
+    }
+}
+
+/* ---------------------------------------------------------------------- */
+/* Entrada desde la pila CAN                                               */
+/* ---------------------------------------------------------------------- */
+
+// Bloque completo del canal ISO-TP: se queda en el pool hasta programarlo
+static uint8_t fw_on_block(uint32_t rx_id, uint8_t *data, uint32_t len, void *ctx)
+{
+    fw_job_t job = { .cmd = 0, .block = data, .len = len };
+    uint8_t busy;
+
+    // Un SF (<= 7 bytes) no cabe en un bloque válido y no se puede retener
+    if (len <= FW_BLOCK_HDR || len > FW_BLOCK_HDR + FW_BLOCK_DATA)
+    {
+        fw_stats.block_errors++;
+        fw_status(FW_EVT_BLOCK_ERR, FW_ERR_SIZE, len > 4 ? fw_get32(data) : 0);
+        return 0;
+    }
+
+    taskENTER_CRITICAL();
+    busy = fw_in_flight >= FW_WINDOW;
+    if (!busy)
+        fw_in_flight++;
+    taskEXIT_CRITICAL();
+
+    if (busy || xQueueSend(fw_queue, &job, 0) != pdTRUE)
+    {
+        if (!busy)
+        {
+            taskENTER_CRITICAL();
+            fw_in_flight--;
+            taskEXIT_CRITICAL();
+        }
+        fw_stats.block_errors++;
+        fw_status(FW_EVT_BLOCK_ERR, FW_ERR_BUSY, fw_get32(data));
+        return 0;
+    }
+
+    return 1;
+}
+
+void FW_Update_OnControl(const can_bsp_msg_t *msg, void *ctx)
+{
+    fw_job_t job = { 0 };
+
+    if (msg->dlc < 1)
+        return;
+
+    job.cmd = msg->data[0];
+
+    switch (job.cmd)
+    {
+    case FW_CMD_BEGIN:
+        if (msg->dlc < 8)
+            return;
+        job.arg0 = msg->data[1] | ((uint32_t)msg->data[2] << 8) | ((uint32_t)msg->data[3] << 16);
+        job.arg1 = fw_get32(&msg->data[4]);
+        break;
+
+    case FW_CMD_COMMIT:
+    case FW_CMD_ABORT:
+    case FW_CMD_ACTIVATE:
+        break;
+
+    default:
+        return;
+    }
+
+    // Las órdenes van en la misma cola: COMMIT se atiende tras los bloques previos
+    if (xQueueSend(fw_queue, &job, 0) != pdTRUE)
+        fw_status(job.cmd, FW_ERR_BUSY, 0);
+}
+
+fw_update_stats_t FW_Update_GetStats(void)
+{
+    return fw_stats;
+}
+
+void FW_Update_Init(void)
+{
+    fw_queue = xQueueCreate(FW_WINDOW + 2, sizeof(fw_job_t));
+
+    if (fw_queue == NULL)
+    {
+        // Error: no se pudo crear la cola
+
+        while(1);  // Quedarse aquí para debug
+    }
+
+    // Sin FC intermedios (BS = 0): el ritmo lo marca la ventana de bloques
+    CAN_TP_Bind(CAN_ID_TP_FW, CAN_ID_TP_FW_FC, fw_on_block, NULL);
+    CAN_TP_SetRxParams(CAN_ID_TP_FW, 0, 0);
+
+    // Prioridad baja: programar flash no debe retrasar puerta ni sensor
+    xTaskCreate(FW_UpdateTask, "FWUPD", 256, NULL, tskIDLE_PRIORITY + 1, NULL);
+}
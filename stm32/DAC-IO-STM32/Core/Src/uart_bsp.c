@@ -9,14 +9,74 @@
 
 #include "uart_bsp.h"
 #include "stm32f4xx_hal.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
 
 /* Este handle lo crea CubeMX */
 extern UART_HandleTypeDef huart2;
 
+/*
+ * Recepción por DMA circular sobre rx_ring: el DMA escribe sin parar y la
+ * tarea lee detrás, así un lector bloqueado (p.ej. UpImage esperando al
+ * CAN) no pierde bytes mientras quepan en el buffer. La posición del DMA
+ * sale de NDTR; rx_written cuenta los bytes escritos desde el arranque,
+ * vueltas incluidas, y se actualiza en cada evento (media vuelta, vuelta
+ * o línea en reposo) y en cada lectura, así ninguna vuelta pasa sin verse.
+ * El byte n está en rx_ring[n % UART_BSP_RX_RING_SIZE].
+ */
+#define RX_MASK  (UART_BSP_RX_RING_SIZE - 1)
+
+static uint8_t rx_ring[UART_BSP_RX_RING_SIZE];
+static volatile uint32_t rx_written;
+static uint16_t rx_dma_pos;
+static uint32_t rx_read;                // solo lo toca la tarea que lee
+static volatile uint32_t rx_resync_at;  // DMA rearmado: la lectura salta aquí
+static volatile uint8_t rx_resync;
+static uart_bsp_stats_t rx_stats;
+static SemaphoreHandle_t rx_sem;
+
+// Con las interrupciones del UART/DMA bloqueadas o desde ellas
+static void uart_bsp_rx_update(void)
+{
+    uint16_t pos = UART_BSP_RX_RING_SIZE - __HAL_DMA_GET_COUNTER(huart2.hdmarx);
+    uint16_t delta = (pos - rx_dma_pos) & RX_MASK;
+
+    rx_written += delta;
+    rx_dma_pos = pos & RX_MASK;
+    rx_stats.rx_bytes += delta;
+}
+
+static void uart_bsp_rx_arm(void)
+{
+    // El DMA vuelve a rx_ring[0]: llevar el contador al inicio de la
+    // siguiente vuelta y descartar lo pendiente
+    rx_written = (rx_written + RX_MASK) & ~(uint32_t)RX_MASK;
+    rx_dma_pos = 0;
+    rx_resync_at = rx_written;
+    rx_resync = 1;
+
+    HAL_UARTEx_ReceiveToIdle_DMA(&huart2, rx_ring, UART_BSP_RX_RING_SIZE);
+}
+
 void uart_bsp_init(void)
 {
-    /* Nada que hacer aquí de momento.
-       El init real lo hace CubeMX */
+    /* El init del periférico lo hace CubeMX; aquí solo arrancamos la RX */
+    if (rx_sem == NULL)
+        rx_sem = xSemaphoreCreateBinary();
+
+    rx_written = 0;
+    rx_read = 0;
+    uart_bsp_rx_arm();
+}
+
+void uart_bsp_flush(void)
+{
+    taskENTER_CRITICAL();
+    uart_bsp_rx_update();
+    rx_read = rx_written;
+    rx_resync = 0;
+    taskEXIT_CRITICAL();
 }
 
 int uart_bsp_tx(const uint8_t *data, size_t len, uint32_t timeout_ms)
@@ -29,9 +89,88 @@ int uart_bsp_tx(const uint8_t *data, size_t len, uint32_t timeout_ms)
 
 int uart_bsp_rx(uint8_t *data, size_t len, uint32_t timeout_ms)
 {
-    if (HAL_UART_Receive(&huart2, data, len, timeout_ms) != HAL_OK)
+    TickType_t start = xTaskGetTickCount();
+    TickType_t timeout = pdMS_TO_TICKS(timeout_ms);
+    size_t got = 0;
+
+    if (rx_sem == NULL)
         return -1;
 
+    while (got < len)
+    {
+        uint32_t avail;
+
+        taskENTER_CRITICAL();
+        uart_bsp_rx_update();
+        if (rx_resync)
+        {
+            rx_read = rx_resync_at;
+            rx_resync = 0;
+        }
+        avail = rx_written - rx_read;
+        taskEXIT_CRITICAL();
+
+        // El DMA ha pasado por encima de bytes sin leer: el paquete en
+        // curso ya no vale, descartar todo lo pendiente
+        if (avail > UART_BSP_RX_RING_SIZE)
+        {
+            rx_stats.rx_overflows++;
+            rx_stats.rx_lost_bytes += avail - UART_BSP_RX_RING_SIZE;
+            rx_read += avail;
+            return -1;
+        }
+
+        if (avail > 0)
+        {
+            while (avail-- > 0 && got < len)
+                data[got++] = rx_ring[rx_read++ & RX_MASK];
+            continue;
+        }
+
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= timeout)
+            return -1;
+
+        // Dormir hasta el reposo de la línea (fin de respuesta) o lo que
+        // tardan en llegar los bytes que faltan (10 bits por byte)
+        TickType_t wait = pdMS_TO_TICKS(((len - got) * 10000UL) / huart2.Init.BaudRate) + 1;
+        if (wait > timeout - elapsed)
+            wait = timeout - elapsed;
+
+        xSemaphoreTake(rx_sem, wait);
+    }
+
     return 0;
 }
 
+uart_bsp_stats_t uart_bsp_get_stats(void)
+{
+    return rx_stats;
+}
+
+/* Media vuelta, vuelta completa o línea en reposo */
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t size)
+{
+    BaseType_t hpw = pdFALSE;
+
+    if (huart != &huart2)
+        return;
+
+    uart_bsp_rx_update();
+
+    if (rx_sem != NULL)
+    {
+        xSemaphoreGiveFromISR(rx_sem, &hpw);
+        portYIELD_FROM_ISR(hpw);
+    }
+}
+
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+    /* Overrun/ruido: el HAL aborta el DMA, volver a armarlo */
+    if (huart == &huart2)
+    {
+        rx_stats.rx_errors++;
+        uart_bsp_rx_arm();
+    }
+}
@@ -0,0 +1,17 @@
+/*
+ * cmsis_os.h (host)
+ *
+ *  Lo justo de CMSIS-RTOS2 para que motor_task.h compile sobre FreeRTOS.
+ */
+
+#ifndef HOST_CMSIS_OS_H_
+#define HOST_CMSIS_OS_H_
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+typedef TaskHandle_t osThreadId_t;
+
+#define osPriorityNormal    (tskIDLE_PRIORITY + 2)
+
+#endif /* HOST_CMSIS_OS_H_ */
@@ -0,0 +1,37 @@
+/*
+ * stm32f4xx_hal.h (host)
+ *
+ *  Sustituto mínimo del HAL para compilar los módulos CAN en Linux.
+ *  Solo cubre lo que usan can_task.c y compañía (LEDs de depuración) y las
+ *  cabeceras de la pantalla para display_bench.c.
+ */
+
+#ifndef HOST_STM32F4XX_HAL_H_
+#define HOST_STM32F4XX_HAL_H_
+
+#include <stdint.h>
+
+#define __weak  __attribute__((weak))
+
+typedef struct {
+    uint32_t ODR;
+} GPIO_TypeDef;
+
+extern GPIO_TypeDef host_gpiod;
+#define GPIOD   (&host_gpiod)
+
+#define GPIO_PIN_12     ((uint16_t)0x1000)
+#define GPIO_PIN_13     ((uint16_t)0x2000)
+#define GPIO_PIN_14     ((uint16_t)0x4000)
+#define GPIO_PIN_15     ((uint16_t)0x8000)
+
+typedef struct {
+    uint32_t State;
+} SPI_HandleTypeDef;
+
+static inline void HAL_GPIO_TogglePin(GPIO_TypeDef *port, uint16_t pin)
+{
+    port->ODR ^= pin;
+}
+
+#endif /* HOST_STM32F4XX_HAL_H_ */
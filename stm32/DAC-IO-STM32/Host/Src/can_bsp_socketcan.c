@@ -0,0 +1,414 @@
+/*
+ * can_bsp_socketcan.c
+ *
+ *  Implementación de can_bsp.h para Linux sobre SocketCAN (vcan0 o un
+ *  adaptador real). Sustituye a Core/Src/can_bsp.c en la build de host:
+ *  can_task.c, can_tp.c, can_od.c, etc. se compilan sin cambios.
+ *
+ *  - Los filtros registrados se pasan al socket (CAN_RAW_FILTER).
+ *  - La tarea CANHOST sondea el socket y entrega lotes de hasta
+ *    CAN_BSP_RX_BATCH tramas a los mismos callbacks que la ISR del bxCAN
+ *    (los IDs asignados a FIFO1 van a CAN_BSP_RxUrgentCallback).
+ *  - vcan no tiene temporización de bit ni contadores de error: la
+ *    temporización solo se valida y se guarda, y el bus siempre está activo.
+ *  - Un solo socket: el bus activo y el modo de redundancia se guardan,
+ *    pero CAN_BSP_SendCritical envía una sola copia.
+ *
+ *  Interfaz: variable de entorno CAN_HOST_IF (por defecto "vcan0").
+ */
+
+#include "can_bsp.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+
+#define CAN_HOST_DEFAULT_IF     "vcan0"
+#define CAN_HOST_POLL_MS        1
+
+typedef struct {
+    uint16_t id;
+    uint16_t mask;
+    uint8_t  fifo;
+} can_bsp_filter_t;
+
+static can_bsp_filter_t filters[CAN_BSP_MAX_FILTERS];
+static uint8_t          num_filters;
+static uint8_t          filters_overflow;
+
+static int                can_fd = -1;
+static can_bsp_tx_stats_t tx_stats;
+static can_bsp_rx_stats_t rx_stats;
+static uint8_t            active_bus = CAN_BSP_BUS1;
+static uint8_t            redundancy = CAN_BSP_REDUNDANCY_NONE;
+static can_bsp_timing_t   bus_timing[2] = {
+    { 500000, 6, 12, 1, 2, 928 },   // lo mismo que MX_CAN1_Init / MX_CAN2_Init
+    { 500000, 6, 12, 1, 2, 928 },
+};
+
+// En host la "marca de ciclos" está directamente en µs (CLOCK_MONOTONIC)
+uint32_t CAN_BSP_Now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+
+uint32_t CAN_BSP_CyclesToUs(uint32_t cycles)
+{
+    return cycles;
+}
+
+static can_bsp_status_t can_bsp_add_mask(uint16_t id, uint16_t mask, uint8_t fifo)
+{
+    id &= mask;
+
+    for (uint8_t i = 0; i < num_filters; i++)
+        if (filters[i].id == id && filters[i].mask == mask && filters[i].fifo == fifo)
+            return CAN_BSP_OK;
+
+    if (num_filters >= CAN_BSP_MAX_FILTERS)
+    {
+        filters_overflow = 1;
+        return CAN_BSP_ERROR;
+    }
+
+    filters[num_filters].id = id;
+    filters[num_filters].mask = mask;
+    filters[num_filters].fifo = fifo;
+    num_filters++;
+
+    return CAN_BSP_OK;
+}
+
+can_bsp_status_t CAN_BSP_AddFilter(uint32_t std_id, uint8_t fifo)
+{
+    if (std_id > 0x7FF || fifo > CAN_BSP_FIFO1)
+        return CAN_BSP_ERROR;
+
+    return can_bsp_add_mask(std_id, 0x7FF, fifo);
+}
+
+can_bsp_status_t CAN_BSP_AddFilterRange(uint32_t first_id, uint32_t last_id, uint8_t fifo)
+{
+    if (first_id > last_id || last_id > 0x7FF || fifo > CAN_BSP_FIFO1)
+        return CAN_BSP_ERROR;
+
+    // Mismo troceado en bloques alineados que en el firmware
+    while (first_id <= last_id)
+    {
+        uint32_t size = 1;
+
+        while ((first_id & (size * 2 - 1)) == 0 && first_id + size * 2 - 1 <= last_id && size < 0x800)
+            size *= 2;
+
+        if (can_bsp_add_mask(first_id, 0x7FF & ~(size - 1), fifo) != CAN_BSP_OK)
+            return CAN_BSP_ERROR;
+
+        first_id += size;
+    }
+
+    return CAN_BSP_OK;
+}
+
+static uint8_t can_bsp_fifo_of(uint32_t id)
+{
+    for (uint8_t i = 0; i < num_filters; i++)
+        if ((id & filters[i].mask) == filters[i].id)
+            return filters[i].fifo;
+
+    return CAN_BSP_FIFO0;
+}
+
+static void can_bsp_set_filters(void)
+{
+    struct can_filter rf[CAN_BSP_MAX_FILTERS];
+
+    // Sin tabla válida: aceptar todo, como el firmware
+    if (num_filters == 0 || filters_overflow)
+        return;
+
+    for (uint8_t i = 0; i < num_filters; i++)
+    {
+        rf[i].can_id   = filters[i].id;
+        rf[i].can_mask = filters[i].mask | CAN_EFF_FLAG | CAN_RTR_FLAG;
+    }
+
+    setsockopt(can_fd, SOL_CAN_RAW, CAN_RAW_FILTER, rf, num_filters * sizeof(rf[0]));
+}
+
+/* ---------------------------------------------------------------------- */
+/* RX                                                                      */
+/* ---------------------------------------------------------------------- */
+
+__weak void CAN_BSP_RxCallback(const can_bsp_msg_t *msgs, uint8_t count)
+{
+    // vacío por defecto
+}
+
+__weak void CAN_BSP_RxUrgentCallback(const can_bsp_msg_t *msgs, uint8_t count)
+{
+    CAN_BSP_RxCallback(msgs, count);
+}
+
+__weak void CAN_BSP_ErrorCallback(uint8_t bus, uint32_t error)
+{
+    // vacío por defecto
+}
+
+can_bsp_rx_stats_t CAN_BSP_GetRxStats(void)
+{
+    return rx_stats;
+}
+
+static void can_bsp_rx_flush(uint8_t fifo, can_bsp_msg_t *batch, uint8_t *n)
+{
+    if (*n == 0)
+        return;
+
+    if (*n > rx_stats.max_batch)
+        rx_stats.max_batch = *n;
+
+    if (fifo == CAN_BSP_FIFO1)
+        CAN_BSP_RxUrgentCallback(batch, *n);
+    else
+        CAN_BSP_RxCallback(batch, *n);
+
+    *n = 0;
+}
+
+/*
+ * Hace de ISR: el puerto POSIX no permite llamar a FreeRTOS desde hilos
+ * propios, así que se sondea el socket (no bloqueante) desde una tarea.
+ */
+static void CAN_HostRxTask(void *arg)
+{
+    can_bsp_msg_t batch[2][CAN_BSP_RX_BATCH];
+    uint8_t n[2];
+    struct can_frame frame;
+
+    for (;;)
+    {
+        n[0] = n[1] = 0;
+
+        while (read(can_fd, &frame, sizeof(frame)) == sizeof(frame))
+        {
+            uint8_t fifo;
+            can_bsp_msg_t *m;
+
+            if (frame.can_id & (CAN_EFF_FLAG | CAN_RTR_FLAG | CAN_ERR_FLAG))
+                continue;
+
+            fifo = can_bsp_fifo_of(frame.can_id);
+            m = &batch[fifo][n[fifo]++];
+            m->id  = frame.can_id & CAN_SFF_MASK;
+            m->dlc = frame.can_dlc;
+            memcpy(m->data, frame.data, 8);
+            m->hw_timestamp = 0;
+            m->timestamp = CAN_BSP_Now();
+
+            if (fifo == CAN_BSP_FIFO1)
+                rx_stats.fifo1_frames++;
+            else
+                rx_stats.fifo0_frames++;
+            rx_stats.bus_frames[active_bus]++;
+
+            if (n[fifo] == CAN_BSP_RX_BATCH)
+                can_bsp_rx_flush(fifo, batch[fifo], &n[fifo]);
+        }
+
+        can_bsp_rx_flush(CAN_BSP_FIFO1, batch[CAN_BSP_FIFO1], &n[CAN_BSP_FIFO1]);
+        can_bsp_rx_flush(CAN_BSP_FIFO0, batch[CAN_BSP_FIFO0], &n[CAN_BSP_FIFO0]);
+
+        vTaskDelay(pdMS_TO_TICKS(CAN_HOST_POLL_MS));
+    }
+}
+
+void CAN_BSP_Init(void)
+{
+    const char *ifname = getenv("CAN_HOST_IF");
+    struct sockaddr_can addr;
+    struct ifreq ifr;
+
+    if (ifname == NULL)
+        ifname = CAN_HOST_DEFAULT_IF;
+
+    can_fd = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    if (can_fd < 0)
+    {
+        perror("socket");
+        exit(1);
+    }
+
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, ifname, IFNAMSIZ - 1);
+    if (ioctl(can_fd, SIOCGIFINDEX, &ifr) < 0)
+    {
+        fprintf(stderr, "CAN: interfaz %s no encontrada\n", ifname);
+        exit(1);
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = ifr.ifr_ifindex;
+    if (bind(can_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        perror("bind");
+        exit(1);
+    }
+
+    can_bsp_set_filters();
+    fcntl(can_fd, F_SETFL, fcntl(can_fd, F_GETFL) | O_NONBLOCK);
+
+    xTaskCreate(CAN_HostRxTask, "CANHOST", configMINIMAL_STACK_SIZE * 4, NULL,
+                configMAX_PRIORITIES - 1, NULL);
+}
+
+/* ---------------------------------------------------------------------- */
+/* TX                                                                      */
+/* ---------------------------------------------------------------------- */
+
+can_bsp_status_t CAN_BSP_Send(uint32_t std_id, const uint8_t *data, uint8_t len)
+{
+    struct can_frame frame;
+
+    if (len > 8)
+        len = 8;
+
+    memset(&frame, 0, sizeof(frame));
+    frame.can_id = std_id & CAN_SFF_MASK;
+    frame.can_dlc = len;
+    memcpy(frame.data, data, len);
+
+    // La cola del socket hace de cola TX: llena = banda llena en el firmware
+    if (write(can_fd, &frame, sizeof(frame)) != sizeof(frame))
+    {
+        tx_stats.overflows++;
+        return CAN_BSP_BUSY;
+    }
+
+    tx_stats.queued++;
+    tx_stats.sent++;
+    return CAN_BSP_OK;
+}
+
+// Un solo socket: los dos buses son el mismo
+can_bsp_status_t CAN_BSP_SendOnBus(uint8_t bus, uint32_t std_id, const uint8_t *data, uint8_t len)
+{
+    return CAN_BSP_Send(std_id, data, len);
+}
+
+uint8_t CAN_BSP_TxIdle(uint8_t bus)
+{
+    return 1;
+}
+
+can_bsp_status_t CAN_BSP_SendCritical(uint32_t std_id, const uint8_t *data, uint8_t len)
+{
+    return CAN_BSP_Send(std_id, data, len);
+}
+
+can_bsp_tx_stats_t CAN_BSP_GetTxStats(void)
+{
+    return tx_stats;
+}
+
+can_bsp_tx_stats_t CAN_BSP_GetBusTxStats(uint8_t bus)
+{
+    return tx_stats;
+}
+
+void CAN_BSP_SetRedundancy(uint8_t mode)
+{
+    if (mode > CAN_BSP_REDUNDANCY_DUAL)
+        return;
+
+    redundancy = mode;
+
+    // Sin redundancia solo se usa CAN1: si estaba conmutado a CAN2, volver
+    if (mode == CAN_BSP_REDUNDANCY_NONE)
+        CAN_BSP_SetActiveBus(CAN_BSP_BUS1);
+}
+
+uint8_t CAN_BSP_GetRedundancy(void)
+{
+    return redundancy;
+}
+
+can_bsp_status_t CAN_BSP_SetActiveBus(uint8_t bus)
+{
+    if (bus > CAN_BSP_BUS2)
+        return CAN_BSP_ERROR;
+
+    active_bus = bus;
+    return CAN_BSP_OK;
+}
+
+uint8_t CAN_BSP_GetActiveBus(void)
+{
+    return active_bus;
+}
+
+void CAN_BSP_ResetTxLatency(void)
+{
+    memset(tx_stats.mb_latency_max_us, 0, sizeof(tx_stats.mb_latency_max_us));
+}
+
+/* ---------------------------------------------------------------------- */
+/* Estado del bus y temporización                                          */
+/* ---------------------------------------------------------------------- */
+
+void CAN_BSP_GetBusStatus(uint8_t bus, can_bsp_bus_status_t *status)
+{
+    memset(status, 0, sizeof(*status));
+}
+
+can_bsp_status_t CAN_BSP_Restart(uint8_t bus)
+{
+    return CAN_BSP_OK;
+}
+
+// Solo comprueba el rango: vcan no tiene reloj de bit
+can_bsp_status_t CAN_BSP_CalcTiming(uint32_t bitrate, uint16_t sample_point, can_bsp_timing_t *timing)
+{
+    if (bitrate == 0 || bitrate > CAN_BSP_MAX_BITRATE || sample_point >= 1000)
+        return CAN_BSP_ERROR;
+
+    memset(timing, 0, sizeof(*timing));
+    timing->bitrate = bitrate;
+    timing->sample_point = sample_point ? sample_point : CAN_BSP_DEFAULT_SP;
+    return CAN_BSP_OK;
+}
+
+can_bsp_status_t CAN_BSP_SetTiming(uint8_t bus, const can_bsp_timing_t *timing)
+{
+    bus_timing[(bus == CAN_BSP_BUS2) ? 1 : 0] = *timing;
+    return CAN_BSP_OK;
+}
+
+can_bsp_status_t CAN_BSP_SetBitrate(uint8_t bus, uint32_t bitrate, uint16_t sample_point)
+{
+    can_bsp_timing_t timing;
+
+    if (CAN_BSP_CalcTiming(bitrate, sample_point, &timing) != CAN_BSP_OK)
+        return CAN_BSP_ERROR;
+
+    return CAN_BSP_SetTiming(bus, &timing);
+}
+
+void CAN_BSP_GetTiming(uint8_t bus, can_bsp_timing_t *timing)
+{
+    *timing = bus_timing[(bus == CAN_BSP_BUS2) ? 1 : 0];
+}
@@ -0,0 +1,245 @@
+/*
+ * display_bench.c
+ *
+ *  Microbenchmark de las primitivas y del texto de display_driver.c en Linux. Cada caso
+ *  dibuja con la implementación actual y con una de referencia píxel a
+ *  píxel (Display_DrawPixel, como hacían DrawLine/FillRect antes), compara
+ *  los dos buffers y mide el tiempo medio por llamada. Las fuentes sin
+ *  referencia (proporcional, dígitos grandes) solo se miden. El BSP y las
+ *  funciones de FreeRTOS que usa el driver se sustituyen aquí, así que
+ *  solo se mide el dibujo en el buffer, no el SPI.
+ *
+ *  Compilar (FreeRTOS-Kernel V10.3.1 o posterior, solo cabeceras):
+ *
+ *    K=$FREERTOS_KERNEL
+ *    gcc -O2 -IHost/Inc -ICore/Inc -I$K/include \
+ *        -I$K/portable/ThirdParty/GCC/Posix \
+ *        Host/Src/display_bench.c Core/Src/display_driver.c \
+ *        Core/Src/display_font.c -o display_bench
+ *
+ *  Uso:
+ *
+ *    ./display_bench [iteraciones]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "display_driver.h"
+#include "display_bsp.h"
+#include "display_font.h"
+
+#define BENCH_ITERATIONS_DEFAULT    20000
+
+typedef void (*bench_fn_t)(color_t color);
+
+typedef struct {
+    const char *name;
+    bench_fn_t  fast;
+    bench_fn_t  reference;
+} bench_case_t;
+
+SPI_HandleTypeDef hspi1;
+
+/* ---------------------------------------------------------------------- */
+/* Stand-in del BSP y del kernel                                           */
+/* ---------------------------------------------------------------------- */
+
+void BSP_SSD1309_Init(void)                                  { }
+void BSP_SSD1309_SetContrast(uint8_t contrast)               { }
+bool BSP_SSD1309_WaitTransfer(void)                          { return true; }
+bool BSP_SSD1309_BatchBegin(void)                            { return true; }
+bool BSP_SSD1309_BatchStart(void)                            { return true; }
+bool BSP_SSD1309_BatchRegion(uint8_t *buffer, uint8_t x0, uint8_t x1,
+                             uint8_t page0, uint8_t page1)   { return true; }
+
+void BSP_SSD1309_Clear(uint8_t *buffer)
+{
+    memset(buffer, 0, SSD1309_WIDTH * SSD1309_HEIGHT / 8);
+}
+
+TickType_t xTaskGetTickCount(void)                           { return 0; }
+void vTaskDelayUntil(TickType_t *prev, const TickType_t inc) { }
+
+/* ---------------------------------------------------------------------- */
+/* Referencia píxel a píxel                                                */
+/* ---------------------------------------------------------------------- */
+
+static void ref_line(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, color_t color)
+{
+    int dx = abs(x1 - x0);
+    int dy = abs(y1 - y0);
+    int sx = (x0 < x1) ? 1 : -1;
+    int sy = (y0 < y1) ? 1 : -1;
+    int err = dx - dy;
+
+    while (1) {
+        Display_DrawPixel(x0, y0, color);
+
+        if (x0 == x1 && y0 == y1) {
+            break;
+        }
+
+        int e2 = 2 * err;
+        if (e2 > -dy) {
+            err -= dy;
+            x0 += sx;
+        }
+        if (e2 < dx) {
+            err += dx;
+            y0 += sy;
+        }
+    }
+}
+
+static void ref_rect(uint8_t x, uint8_t y, uint8_t w, uint8_t h, color_t color)
+{
+    ref_line(x, y, x + w - 1, y, color);
+    ref_line(x, y + h - 1, x + w - 1, y + h - 1, color);
+    ref_line(x, y, x, y + h - 1, color);
+    ref_line(x + w - 1, y, x + w - 1, y + h - 1, color);
+}
+
+static void ref_fill(uint8_t x, uint8_t y, uint8_t w, uint8_t h, color_t color)
+{
+    for (uint8_t i = 0; i < h; i++) {
+        ref_line(x, y + i, x + w - 1, y + i, color);
+    }
+}
+
+static void ref_string(uint8_t x, uint8_t y, const char *str, uint8_t scale, color_t color)
+{
+    for (; *str && x + 6 * scale <= DISPLAY_WIDTH; str++, x += 6 * scale) {
+        const uint8_t *glyph = font_6x8[*str - FONT_6X8_FIRST];
+
+        for (uint8_t i = 0; i < 6 * scale; i++) {
+            for (uint8_t j = 0; j < 8 * scale; j++) {
+                if (glyph[i / scale] & (1 << (j / scale))) {
+                    Display_DrawPixel(x + i, y + j, color);
+                }
+            }
+        }
+    }
+}
+
+/* ---------------------------------------------------------------------- */
+/* Casos                                                                   */
+/* ---------------------------------------------------------------------- */
+
+static void fill_screen(color_t c)      { Display_FillRect(0, 0, 128, 64, c); }
+static void fill_screen_ref(color_t c)  { ref_fill(0, 0, 128, 64, c); }
+static void fill_box(color_t c)         { Display_FillRect(13, 5, 50, 21, c); }
+static void fill_box_ref(color_t c)     { ref_fill(13, 5, 50, 21, c); }
+static void frame(color_t c)            { Display_DrawRect(2, 3, 124, 58, c); }
+static void frame_ref(color_t c)        { ref_rect(2, 3, 124, 58, c); }
+static void hline(color_t c)            { Display_DrawLine(0, 37, 127, 37, c); }
+static void hline_ref(color_t c)        { ref_line(0, 37, 127, 37, c); }
+static void vline(color_t c)            { Display_DrawLine(90, 63, 90, 1, c); }
+static void vline_ref(color_t c)        { ref_line(90, 63, 90, 1, c); }
+static void clip_fill(color_t c)        { Display_FillRect(100, 50, 60, 40, c); }
+static void clip_fill_ref(color_t c)    { ref_fill(100, 50, 28, 14, c); }
+static void text_aligned(color_t c)     { Display_DrawString(15, 16, "LEO CADAVID", FONT_6X8, c); }
+static void text_aligned_ref(color_t c) { ref_string(15, 16, "LEO CADAVID", 1, c); }
+static void text_shifted(color_t c)     { Display_DrawString(5, 35, "confirmation", FONT_6X8, c); }
+static void text_shifted_ref(color_t c) { ref_string(5, 35, "confirmation", 1, c); }
+static void text_bottom(color_t c)      { Display_DrawString(90, 60, "Ready!!", FONT_6X8, c); }
+static void text_bottom_ref(color_t c)  { ref_string(90, 60, "Ready!!", 1, c); }
+static void text_double(color_t c)      { Display_DrawString(4, 21, "Door open", FONT_12X16, c); }
+static void text_double_ref(color_t c)  { ref_string(4, 21, "Door open", 2, c); }
+static void text_prop(color_t c)        { Display_DrawString(5, 35, "confirmation", FONT_6X8_PROP, c); }
+static void text_digits(color_t c)      { Display_DrawString(24, 20, "12:34", FONT_DIGITS_14X24, c); }
+
+static const bench_case_t cases[] = {
+    { "FillRect 128x64",        fill_screen,    fill_screen_ref },
+    { "FillRect 50x21 (13,5)",  fill_box,       fill_box_ref    },
+    { "DrawRect 124x58 (2,3)",  frame,          frame_ref       },
+    { "DrawLine horizontal",    hline,          hline_ref       },
+    { "DrawLine vertical",      vline,          vline_ref       },
+    { "FillRect recortado",     clip_fill,      clip_fill_ref   },
+    { "DrawString y=16",        text_aligned,   text_aligned_ref },
+    { "DrawString y=35",        text_shifted,   text_shifted_ref },
+    { "DrawString recortado",   text_bottom,    text_bottom_ref },
+    { "DrawString 12x16",       text_double,    text_double_ref },
+    { "DrawString proporcional", text_prop,     NULL            },
+    { "DrawString 14x24",       text_digits,    NULL            },
+};
+
+static double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Fondo a medias para que se noten tanto el OR como el AND */
+static void prepare(void)
+{
+    uint8_t *buffer;
+
+    Display_Clear();
+    buffer = Display_GetBuffer();
+    for (uint16_t i = 0; i < DISPLAY_WIDTH * DISPLAY_HEIGHT / 8; i++) {
+        buffer[i] = (uint8_t)(i * 37);
+    }
+}
+
+static double run(bench_fn_t fn, color_t color, uint32_t iterations)
+{
+    double t0;
+
+    prepare();
+    t0 = now_ns();
+    for (uint32_t i = 0; i < iterations; i++) {
+        fn(color);
+    }
+    return (now_ns() - t0) / iterations;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t iterations = BENCH_ITERATIONS_DEFAULT;
+    static uint8_t expected[DISPLAY_WIDTH * DISPLAY_HEIGHT / 8];
+    int failures = 0;
+
+    if (argc > 1)
+        iterations = strtoul(argv[1], NULL, 0);
+    if (iterations == 0)
+        iterations = BENCH_ITERATIONS_DEFAULT;
+
+    Display_Init();
+
+    printf("%-24s %6s %12s %12s %8s\n", "caso", "color", "ref (ns)", "actual (ns)", "x");
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        for (color_t color = COLOR_BLACK; color <= COLOR_WHITE; color++) {
+            double t_ref, t_fast;
+            bool same;
+
+            if (cases[i].reference == NULL) {
+                t_fast = run(cases[i].fast, color, iterations);
+                printf("%-24s %6s %12s %12.1f\n", cases[i].name,
+                       color == COLOR_WHITE ? "blanco" : "negro", "-", t_fast);
+                continue;
+            }
+
+            t_ref = run(cases[i].reference, color, iterations);
+            memcpy(expected, Display_GetBuffer(), sizeof(expected));
+            t_fast = run(cases[i].fast, color, iterations);
+            same = memcmp(expected, Display_GetBuffer(), sizeof(expected)) == 0;
+
+            printf("%-24s %6s %12.1f %12.1f %8.1f%s\n", cases[i].name,
+                   color == COLOR_WHITE ? "blanco" : "negro",
+                   t_ref, t_fast, t_ref / t_fast, same ? "" : "  DISTINTO");
+            if (!same)
+                failures++;
+        }
+    }
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,242 @@
+/*
+ * host_node.c
+ *
+ *  Nodo STM32 en Linux: la pila CAN del firmware (can_task.c, can_tp.c,
+ *  can_dispatch.c, can_od.c, can_health.c, can_heartbeat.c, can_bitrate.c)
+ *  sobre can_bsp_socketcan.c y el puerto POSIX de FreeRTOS. Motor, pantalla
+ *  y sensor se sustituyen por los stand-ins de este fichero; el sensor
+ *  simulado genera accesos y mide evento -> confirmación de la RPi.
+ *
+ *  Compilar (FreeRTOS-Kernel V10.3.1 o posterior, fuera del repositorio):
+ *
+ *    K=$FREERTOS_KERNEL
+ *    gcc -O2 -pthread -IHost/Inc -ICore/Inc -I$K/include \
+ *        -I$K/portable/ThirdParty/GCC/Posix -I$K/portable/ThirdParty/GCC/Posix/utils \
+ *        Host/Src/can_bsp_socketcan.c Host/Src/host_node.c \
+ *        Core/Src/can_task.c Core/Src/can_tp.c Core/Src/can_dispatch.c \
+ *        Core/Src/can_od.c Core/Src/can_health.c Core/Src/can_heartbeat.c \
+ *        Core/Src/can_bitrate.c $K/tasks.c $K/queue.c $K/list.c $K/timers.c \
+ *        $K/portable/MemMang/heap_4.c $K/portable/ThirdParty/GCC/Posix/port.c \
+ *        $K/portable/ThirdParty/GCC/Posix/utils/wait_for_event.c -o can_host
+ *
+ *  Uso (desde stm32/DAC-IO-STM32, con rpi/can_standin.py en el mismo bus):
+ *
+ *    sudo ip link add dev vcan0 type vcan && sudo ip link set up vcan0
+ *    ./can_host [eventos/s] [segundos] [% de MATCH]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+#include "can_task.h"
+#include "can_bsp.h"
+#include "fingerprint_task.h"
+#include "motor_task.h"
+#include "display_task.h"
+#include "display_driver.h"
+
+#define HOST_EVENT_RATE_DEFAULT     50
+#define HOST_DURATION_S_DEFAULT     10
+#define HOST_MATCH_PCT_DEFAULT      50
+#define HOST_CONFIRM_TIMEOUT_MS     1000
+
+GPIO_TypeDef host_gpiod;
+
+static uint32_t event_rate = HOST_EVENT_RATE_DEFAULT;
+static uint32_t duration_s = HOST_DURATION_S_DEFAULT;
+static uint32_t match_pct  = HOST_MATCH_PCT_DEFAULT;
+
+void vAssertCalled(const char *file, unsigned long line)
+{
+    fprintf(stderr, "assert %s:%lu\n", file, line);
+    abort();
+}
+
+/* ---------------------------------------------------------------------- */
+/* Stand-in de motor y pantalla                                            */
+/* ---------------------------------------------------------------------- */
+
+static Door_Status_t door = {
+    .state = DOOR_STATE_CLOSED,
+    .open_time_ms = 5000,
+    .motor_speed_ms = 2,
+};
+static uint8_t contrast = 0xCF;
+
+bool MotorTask_OpenDoor(void)
+{
+    door.state = DOOR_STATE_OPEN;
+    door.operations_count++;
+    return true;
+}
+
+bool MotorTask_CloseDoor(void)
+{
+    door.state = DOOR_STATE_CLOSED;
+    door.operations_count++;
+    return true;
+}
+
+bool MotorTask_EmergencyStop(void)
+{
+    door.is_moving = false;
+    return true;
+}
+
+bool MotorTask_SetOpenTime(uint32_t time_ms)  { door.open_time_ms = time_ms; return true; }
+bool MotorTask_SetSpeed(uint32_t speed_ms)    { door.motor_speed_ms = speed_ms; return true; }
+Door_Status_t MotorTask_GetDoorStatus(void)   { return door; }
+
+void DisplayTask_SetContrast(uint8_t value)   { contrast = value; }
+uint8_t DisplayTask_GetContrast(void)         { return contrast; }
+display_update_stats_t Display_GetUpdateStats(void) { display_update_stats_t s = { 0 }; return s; }
+display_render_stats_t DisplayTask_GetRenderStats(void) { display_render_stats_t s = { 0 }; return s; }
+
+/* ---------------------------------------------------------------------- */
+/* Stand-in de la tarea de huella                                          */
+/* ---------------------------------------------------------------------- */
+
+static QueueHandle_t       fp_queue;
+static QueueHandle_t       fp_confirm_queue;
+static fingerprint_stats_t fp_stats;
+static uint32_t            fp_quiet_ms = FP_DUPLICATE_QUIET_MS;
+static uint8_t             fp_upload = FP_IMAGE_UPLOAD_ON_REJECT;
+
+QueueHandle_t FingerprintTask_GetQueue(void)         { return fp_queue; }
+QueueHandle_t FingerprintTask_GetConfirmQueue(void)  { return fp_confirm_queue; }
+fingerprint_stats_t FingerprintTask_GetStats(void)   { return fp_stats; }
+void FingerprintTask_SetQuietInterval(uint32_t ms)   { fp_quiet_ms = ms; }
+uint32_t FingerprintTask_GetQuietInterval(void)      { return fp_quiet_ms; }
+void FingerprintTask_SetImageUpload(uint8_t on)      { fp_upload = on; }
+uint8_t FingerprintTask_GetImageUpload(void)         { return fp_upload; }
+void Fingerprint_RequestEnroll(void)                 { }
+void Fingerprint_CancelEnroll(void)                  { }
+void Fingerprint_RequestImageUpload(void)            { }
+
+/* Sin flash que programar: la actualización de firmware queda fuera */
+void FW_Update_Init(void)                             { }
+void FW_Update_OnControl(const can_bsp_msg_t *msg, void *ctx) { }
+
+/*
+ * Sensor simulado: un acceso cada 1/event_rate s. Los MATCH esperan la
+ * confirmación como FP_STATE_WAIT_CONFIRM, pero con timeout corto.
+ */
+static void HostSensorTask(void *arg)
+{
+    TickType_t period = pdMS_TO_TICKS(1000 / event_rate) ? pdMS_TO_TICKS(1000 / event_rate) : 1;
+    TickType_t start = xTaskGetTickCount();
+    TickType_t last = start;
+    uint32_t rtt_sum = 0, rtt_min = UINT32_MAX, rtt_max = 0;
+    uint32_t timeouts = 0;
+
+    while ((xTaskGetTickCount() - start) < pdMS_TO_TICKS(duration_s * 1000))
+    {
+        fingerprint_event_t evt = { .kind = FP_EVT_AUTH };
+        uint8_t confirm;
+
+        fp_stats.scans++;
+
+        if ((uint32_t)(rand() % 100) < match_pct)
+        {
+            TickType_t t0;
+
+            evt.status = AS608_MATCH;
+            evt.id = 1 + rand() % 100;
+            fp_stats.matches++;
+
+            xQueueReset(fp_confirm_queue);
+            t0 = xTaskGetTickCount();
+            xQueueSend(fp_queue, &evt, portMAX_DELAY);
+
+            if (xQueueReceive(fp_confirm_queue, &confirm, pdMS_TO_TICKS(HOST_CONFIRM_TIMEOUT_MS)))
+            {
+                uint32_t rtt = (xTaskGetTickCount() - t0) * portTICK_PERIOD_MS;
+
+                rtt_sum += rtt;
+                if (rtt < rtt_min)
+                    rtt_min = rtt;
+                if (rtt > rtt_max)
+                    rtt_max = rtt;
+            }
+            else
+            {
+                timeouts++;
+            }
+        }
+        else
+        {
+            evt.status = AS608_NO_MATCH;
+            fp_stats.rejections++;
+            xQueueSend(fp_queue, &evt, portMAX_DELAY);
+        }
+
+        vTaskDelayUntil(&last, period);
+    }
+
+    {
+        uint32_t confirmed = fp_stats.matches - timeouts;
+        uint32_t elapsed_ms = (xTaskGetTickCount() - start) * portTICK_PERIOD_MS;
+        can_app_stats_t app = CAN_App_GetStats();
+        can_bsp_tx_stats_t tx = CAN_BSP_GetTxStats();
+        can_bsp_rx_stats_t rx = CAN_BSP_GetRxStats();
+
+        printf("eventos: %u en %u ms (%.1f/s), MATCH %u, sin confirmar %u\n",
+               fp_stats.scans, elapsed_ms, fp_stats.scans * 1000.0 / elapsed_ms,
+               fp_stats.matches, timeouts);
+        if (confirmed > 0)
+            printf("evento -> confirmación: min %u ms, media %.1f ms, max %u ms\n",
+                   rtt_min, (double)rtt_sum / confirmed, rtt_max);
+        printf("tramas de eventos %u, retransmisiones %u\n",
+               app.evt_frames, app.evt_retransmits);
+        printf("CAN tx %u (%.0f/s), desbordes %u; rx %u (%.0f/s), descartes cola %u\n",
+               tx.sent, tx.sent * 1000.0 / elapsed_ms, tx.overflows,
+               rx.fifo0_frames + rx.fifo1_frames,
+               (rx.fifo0_frames + rx.fifo1_frames) * 1000.0 / elapsed_ms,
+               app.rx_queue_drops);
+
+        for (uint8_t path = CAN_RX_PATH_NORMAL; path <= CAN_RX_PATH_URGENT; path++)
+        {
+            can_rx_latency_t lat = CAN_App_GetRxLatency(path);
+
+            printf("RX %s: %u tramas, RX->cola max %u us, RX->tarea max %u us, handler max %u us\n",
+                   path == CAN_RX_PATH_URGENT ? "urgente" : "normal", lat.frames,
+                   lat.to_queue_max_us, lat.to_task_max_us, lat.handler_max_us);
+        }
+    }
+
+    exit(0);
+}
+
+void FingerprintTask_Init(void)
+{
+    fp_queue = xQueueCreate(4, sizeof(fingerprint_event_t));
+    fp_confirm_queue = xQueueCreate(1, sizeof(uint8_t));
+
+    xTaskCreate(HostSensorTask, "FPHOST", configMINIMAL_STACK_SIZE * 4, NULL,
+                tskIDLE_PRIORITY + 1, NULL);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1)
+        event_rate = strtoul(argv[1], NULL, 0);
+    if (argc > 2)
+        duration_s = strtoul(argv[2], NULL, 0);
+    if (argc > 3)
+        match_pct = strtoul(argv[3], NULL, 0);
+
+    if (event_rate == 0 || event_rate > 1000)
+        event_rate = HOST_EVENT_RATE_DEFAULT;
+
+    // Mismo orden que RTOS_THREADS en main.c
+    FingerprintTask_Init();
+    CANTask_Init();
+    CAN_BSP_Init();
+
+    vTaskStartScheduler();
+    return 0;
+}
@@ -0,0 +1,148 @@
+"""
+Generador de la fuente numérica grande de display_font.c (FONT_DIGITS_14X24).
+
+Los dígitos se dibujan como 7 segmentos de 3 px con los extremos en punta,
+se pasan al formato de página del SSD1309 (un byte por columna, LSB arriba,
+primero todas las columnas de la página 0, luego la 1...) y se comprimen
+con RLE:
+
+    0x00-0x7F  n + 1 bytes literales a continuación
+    0x80-0xFF  el byte siguiente repetido (n & 0x7F) + 1 veces
+
+Uso (pegar la salida en display_font.c en lugar de la tabla anterior):
+    python3 Host/font_gen.py
+"""
+
+WIDTH = 14
+HEIGHT = 24
+PAGES = HEIGHT // 8
+
+# Fila central de los segmentos horizontales; (columna central, fila0, fila1)
+# de los verticales
+H_SEGMENTS = {"a": 1, "g": 11, "d": 22}
+V_SEGMENTS = {"f": (1, 3, 9), "b": (12, 3, 9), "e": (1, 13, 20), "c": (12, 13, 20)}
+
+DIGITS = {
+    "0": "abcdef", "1": "bc", "2": "abdeg", "3": "abcdg", "4": "bcfg",
+    "5": "acdfg", "6": "acdefg", "7": "abc", "8": "abcdefg", "9": "abcdfg",
+    "-": "g",
+}
+
+
+def blank(width):
+    return [[0] * width for _ in range(HEIGHT)]
+
+
+def segment_glyph(segments):
+    px = blank(WIDTH)
+    for s in segments:
+        if s in H_SEGMENTS:
+            row = H_SEGMENTS[s]
+            for c in range(3, WIDTH - 3):
+                px[row - 1][c] = px[row + 1][c] = 1
+            for c in range(2, WIDTH - 2):
+                px[row][c] = 1
+        else:
+            col, r0, r1 = V_SEGMENTS[s]
+            for r in range(r0 + 1, r1):
+                px[r][col - 1] = px[r][col + 1] = 1
+            for r in range(r0, r1 + 1):
+                px[r][col] = 1
+    return px
+
+
+def dots_glyph(rows):
+    px = blank(3)
+    for r0 in rows:
+        for r in range(r0, r0 + 3):
+            px[r] = [1, 1, 1]
+    return px
+
+
+def to_pages(px):
+    width = len(px[0])
+    out = []
+    for page in range(PAGES):
+        for c in range(width):
+            byte = 0
+            for bit in range(8):
+                if px[page * 8 + bit][c]:
+                    byte |= 1 << bit
+            out.append(byte)
+    return out
+
+
+def rle(data):
+    out = []
+    i = 0
+    while i < len(data):
+        run = 1
+        while i + run < len(data) and data[i + run] == data[i] and run < 128:
+            run += 1
+        if run >= 3:
+            out += [0x80 | (run - 1), data[i]]
+            i += run
+            continue
+        lit = i
+        while lit < len(data) and lit - i < 128:
+            if lit + 2 < len(data) and data[lit] == data[lit + 1] == data[lit + 2]:
+                break
+            lit += 1
+        out += [lit - i - 1] + data[i:lit]
+        i = lit
+    return out
+
+
+def unrle(data, size):
+    out = []
+    i = 0
+    while len(out) < size:
+        n = data[i]
+        if n & 0x80:
+            out += [data[i + 1]] * ((n & 0x7F) + 1)
+            i += 2
+        else:
+            out += data[i + 1:i + 2 + n]
+            i += n + 2
+    return out
+
+
+def main():
+    glyphs = {ch: segment_glyph(seg) for ch, seg in DIGITS.items()}
+    glyphs["."] = dots_glyph([21])
+    glyphs[":"] = dots_glyph([6, 15])
+
+    first, last = "-", ":"
+    data, table, raw = [], [], 0
+
+    for code in range(ord(first), ord(last) + 1):
+        ch = chr(code)
+        if ch not in glyphs:
+            table.append((0, 0, ch))
+            continue
+        pages = to_pages(glyphs[ch])
+        packed = rle(pages)
+        assert unrle(packed, len(pages)) == pages
+        table.append((len(data), len(glyphs[ch][0]), ch))
+        data += packed
+        raw += len(pages)
+
+    print(f"/* {raw} bytes raw, {len(data)} RLE-compressed (Host/font_gen.py) */")
+    print(f"static const uint8_t font_digits_rle[{len(data)}] = {{")
+    for ch_off, width, ch in table:
+        if width == 0:
+            continue
+        end = next((o for o, w, _ in table if w and o > ch_off), len(data))
+        chunk = ", ".join(f"0x{b:02X}" for b in data[ch_off:end])
+        print(f"    {chunk}, // {ch}")
+    print("};")
+    print()
+    print(f"static const font_glyph_t font_digits_glyphs[{len(table)}] = {{")
+    for off, width, ch in table:
+        note = ch if width else f"{ch} (no glyph)"
+        print(f"    {{ {off:3d}, {width:2d} }},  // {note}")
+    print("};")
+
+
+if __name__ == "__main__":
+    main()
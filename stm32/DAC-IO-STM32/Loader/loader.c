@@ -0,0 +1,149 @@
+/*
+ * loader.c
+ *
+ *  Cargador del sector 0 (16 KB). En cada arranque:
+ *
+ *  1. Si el staging tiene una imagen válida marcada con activate y sin
+ *     installed (ver fw_image.h), borra los sectores 1-7, la copia,
+ *     comprueba el CRC de la copia y escribe installed. Si se corta la
+ *     alimentación antes de installed, el siguiente arranque repite todo:
+ *     la copia no se da por hecha hasta verificarla.
+ *  2. Salta a la aplicación de 0x08004000 si sus vectores son válidos.
+ *
+ *  Solo registros (CMSIS), sin HAL ni interrupciones, a 16 MHz (HSI, el
+ *  reloj de reset: la flash no necesita wait states). Borrar desde el
+ *  sector 0 los sectores 1-7 detiene la CPU durante cada borrado, pero
+ *  aquí no hay nada más que atender.
+ *
+ *  Se compila con Loader/Makefile (make -C Loader, con los Drivers que
+ *  genera CubeMX) y se graba una vez con ST-Link en 0x08000000
+ *  (make -C Loader flash). La aplicación se depura y graba como siempre
+ *  desde STM32CubeIDE, ya enlazada en 0x08004000. Ver docs/software.md.
+ */
+
+#include "stm32f4xx.h"
+#include "fw_image.h"
+
+#define LOADER_ATTEMPTS         3
+
+extern uint32_t _estack;
+
+typedef void (*loader_vector_t)(void);
+
+void Reset_Handler(void);
+void Loader_Fault(void);
+
+/* Solo pila y reset: el cargador no habilita ninguna interrupción */
+__attribute__((section(".isr_vector"), used))
+static const loader_vector_t loader_vectors[] = {
+    (loader_vector_t)&_estack,
+    Reset_Handler,
+    Loader_Fault,       // NMI
+    Loader_Fault,       // HardFault
+};
+
+void Loader_Fault(void)
+{
+    // Reiniciar: si había una copia pendiente se repite desde el principio
+    NVIC_SystemReset();
+}
+
+/* ---------------------------------------------------------------------- */
+/* Flash                                                                   */
+/* ---------------------------------------------------------------------- */
+
+#define LOADER_FLASH_ERRORS     (FLASH_SR_WRPERR | FLASH_SR_PGAERR | FLASH_SR_PGPERR | FLASH_SR_PGSERR)
+
+static void loader_flash_unlock(void)
+{
+    if (FLASH->CR & FLASH_CR_LOCK)
+    {
+        FLASH->KEYR = 0x45670123;
+        FLASH->KEYR = 0xCDEF89AB;
+    }
+    FLASH->SR = FLASH_SR_EOP | LOADER_FLASH_ERRORS;
+}
+
+static uint8_t loader_flash_wait(void)
+{
+    while (FLASH->SR & FLASH_SR_BSY);
+    return (FLASH->SR & LOADER_FLASH_ERRORS) == 0;
+}
+
+static uint8_t loader_erase_sector(uint32_t sector)
+{
+    FLASH->CR = FLASH_CR_PSIZE_1 | FLASH_CR_SER | (sector << FLASH_CR_SNB_Pos);
+    FLASH->CR |= FLASH_CR_STRT;
+    return loader_flash_wait();
+}
+
+static uint8_t loader_program(volatile uint32_t *dst, uint32_t word)
+{
+    FLASH->CR = FLASH_CR_PSIZE_1 | FLASH_CR_PG;
+    *dst = word;
+    return loader_flash_wait() && *dst == word;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Instalación                                                             */
+/* ---------------------------------------------------------------------- */
+
+static uint8_t loader_install(const fw_header_t *hdr)
+{
+    const uint32_t *src = (const uint32_t *)FW_STAGE_BASE;
+    volatile uint32_t *dst = (volatile uint32_t *)FW_APP_BASE;
+    uint8_t ok = 1;
+
+    loader_flash_unlock();
+
+    for (uint32_t s = 0; ok && s < FW_APP_SECTORS; s++)
+        ok = loader_erase_sector(FW_APP_FIRST_SECTOR + s);
+
+    for (uint32_t i = 0; ok && i < (hdr->size + 3) / 4; i++)
+        ok = loader_program(&dst[i], src[i]);
+
+    // La copia tiene que dar el CRC con el que se validó el staging
+    if (ok)
+        ok = FW_Image_Crc32(0, (const uint8_t *)FW_APP_BASE, hdr->size) == hdr->crc;
+
+    if (ok)
+        ok = loader_program((volatile uint32_t *)&hdr->installed, FW_INSTALLED_MAGIC);
+
+    FLASH->CR = FLASH_CR_LOCK;
+    return ok;
+}
+
+static void loader_start_app(void)
+{
+    const uint32_t *vectors = (const uint32_t *)FW_APP_BASE;
+
+    SCB->VTOR = FW_APP_BASE;
+    __DSB();
+    __set_MSP(vectors[0]);
+    ((void (*)(void))vectors[1])();
+}
+
+void Reset_Handler(void)
+{
+    const fw_header_t *hdr = (const fw_header_t *)FW_HEADER_ADDR;
+
+    if (hdr->activate == FW_ACTIVATE_MAGIC && hdr->installed == FW_WORD_ERASED &&
+        FW_Image_StageValid() != NULL)
+    {
+        uint8_t installed = 0;
+
+        for (uint8_t attempt = 0; !installed && attempt < LOADER_ATTEMPTS; attempt++)
+            installed = loader_install(hdr);
+
+        // Copia sin verificar: no se arranca una aplicación a medias. La
+        // marca sigue pendiente y el reset lo vuelve a intentar
+        if (!installed)
+            NVIC_SystemReset();
+    }
+
+    if (FW_Image_VectorsValid((const uint32_t *)FW_APP_BASE, FW_APP_SIZE))
+        loader_start_app();
+
+    // Sin aplicación ni imagen que instalar: no queda más que el ST-Link
+    while(1);
+}